@@ -22,61 +22,61 @@ my $speedtab = {};
 #ply | answer
 #====+=======
 #  7 |   e2e4
-#  6 |   b1c3
-#  5 |   b2b4
-#  4 |   g1f3
-#  3 |   g1f3
-#  2 |   d2d4
+#  6 |   e2e4
+#  5 |   d2d4
+#  4 |   e2e4
+#  3 |   e2e4
+#  2 |   e2e4
 
 $anskey->{1}->{2} = "e2e4";
 $anskey->{1}->{3} = "e2e4";
-$anskey->{1}->{4} = "d2d4";
-$anskey->{1}->{5} = "g1f3";
+$anskey->{1}->{4} = "e2e4";
+$anskey->{1}->{5} = "d2d4";
 
 #board2
 #ply | answer
 #====+=======
-#  7 |   d1b3
+#  7 |   c1d2
 #  6 |   c1d2
-#  5 |   c1g5
-#  4 |   c1g5
+#  5 |   c1d2
+#  4 |   c1d2
 #  3 |   c1d2
-#  2 |   e2e4
+#  2 |   e2e3
 
-$anskey->{2}->{2} = "e2e4";
-$anskey->{2}->{3} = "e1d2";
+$anskey->{2}->{2} = "e2e3";
+$anskey->{2}->{3} = "c1d2";
 $anskey->{2}->{4} = "c1d2";
-$anskey->{2}->{5} = "c1g5";
+$anskey->{2}->{5} = "c1d2";
 
 #board3
 #ply | answer
 #====+=======
-#  7 |   f5h7
+#  7 |   f5g7
 #  6 |   f5g7
-#  5 |   f5h6
+#  5 |   f5g7
 #  4 |   f5g7
-#  3 |   f3b3
-#  2 |   b2b3
+#  3 |   f5g7
+#  2 |   f5g7
 
 $anskey->{3}->{2} = "f5g7";
-$anskey->{3}->{3} = "b2b3";
-$anskey->{3}->{4} = "f3h5";
-$anskey->{3}->{5} = "g5g6";
+$anskey->{3}->{3} = "f5g7";
+$anskey->{3}->{4} = "f5g7";
+$anskey->{3}->{5} = "f5g7";
 
 #board4
 #ply | answer
 #====+=======
-#  7 |   e5f5
-#  6 |   e5e3
-#  5 |   h5h6
-#  4 |   e5e3
-#  3 |   e5b5
-#  2 |   e5e3
-
-$anskey->{4}->{2} = "e5a5";
-$anskey->{4}->{3} = "g5f7";
-$anskey->{4}->{4} = "g5f7";
-$anskey->{4}->{5} = "g5f7";
+#  7 |   g5h3
+#  6 |   g5e4
+#  5 |   h1g1
+#  4 |   g5e4
+#  3 |   e5e3
+#  2 |   g5e4
+
+$anskey->{4}->{2} = "g5e4";
+$anskey->{4}->{3} = "e5e3";
+$anskey->{4}->{4} = "g5e4";
+$anskey->{4}->{5} = "h1g1";
 
 my $bad_score = -6666;
 my $tot_time = 0;
@@ -186,9 +186,13 @@ sub genbench {
     $runs = 1 if($sm eq "minimax");
     $runs = 3 if($ply > 5);
     open($fd,">.bench");
+    # the answer key was made without null move pruning or LMR,
+    # which let the score depend on the search window
 print $fd qq{
 search $sm
 eval original
+nullmove off
+lmr off
 bench inputs/board$b $ply $runs
 quit
 
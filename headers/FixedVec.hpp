@@ -43,6 +43,18 @@ struct FixedVec {
             data[_size++] = t;
         }
     }
+    void pop_back() {
+        assert(_size > 0);
+        _size--;
+    }
+    // Puts back an entry that push_back() dropped off the front
+    void push_front(T t) {
+        assert(_size < N);
+        for(int i=_size;i>0;i--)
+            data[i] = data[i-1];
+        data[0] = t;
+        _size++;
+    }
     int size() const {
         return _size;
     }
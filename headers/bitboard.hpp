@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+#include <stdint.h>
+
+/**
+ * A bitboard is a set of squares, bit n standing for square n
+ * (so bit 0 is a8 and bit 63 is h1, like the rest of the board).
+ */
+typedef uint64_t bitboard_t;
+
+/**
+ * The attacks of a bishop or rook on one square for every way the
+ * squares around it can be occupied. Only the squares in mask can
+ * block it, and multiplying them by magic packs them into an index
+ * into attacks (the "fancy" magic bitboards of Pradyumna Kannan).
+ */
+struct magic_t {
+    bitboard_t mask;
+    bitboard_t magic;
+    bitboard_t *attacks;
+    int shift;
+
+    unsigned index(bitboard_t occ) const {
+        return unsigned(((occ & mask) * magic) >> shift);
+    }
+};
+
+extern bitboard_t knight_attacks[64];
+extern bitboard_t king_attacks[64];
+extern bitboard_t pawn_attacks[2][64];  // [color][square]
+extern magic_t bishop_magic[64];
+extern magic_t rook_magic[64];
+
+void init_bitboards();
+
+inline bitboard_t square_bb(int sq) {
+    return bitboard_t(1) << sq;
+}
+
+inline int lsb(bitboard_t b) {
+    return __builtin_ctzll(b);
+}
+
+/* pop_lsb() removes the lowest square from b and returns it */
+inline int pop_lsb(bitboard_t& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+inline bitboard_t bishop_attacks(int sq, bitboard_t occ) {
+    return bishop_magic[sq].attacks[bishop_magic[sq].index(occ)];
+}
+
+inline bitboard_t rook_attacks(int sq, bitboard_t occ) {
+    return rook_magic[sq].attacks[rook_magic[sq].index(occ)];
+}
+
+#endif
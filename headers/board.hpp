@@ -7,24 +7,51 @@
 #ifndef BOARD_H
 #define BOARD_H
 #include <iostream>
+#include <string>
 #include "node.hpp"
 #include "defs.hpp"
 #include "data.hpp"
 #include "hash.hpp"
 #include "chess_move.hpp"
+#include "move_list.hpp"
+
+/**
+ * What makemove() needs to remember so unmakemove() can put the
+ * board back: everything a chess_move can't be run backwards to find.
+ */
+struct undo_t {
+    chess_move m;
+    hash_t hash;
+    int castle;
+    int ep;
+    int fifty;
+    char captured;       // the piece on the to square, or EMPTY
+    bool hist_full;      // hist_dat was full, so hist_lost fell off
+    hash_t hist_lost;
+};
 
 void init_board(node_t& board);
 void init_hash();
 hash_t hash_rand();
 hash_t set_hash(node_t& board);
-hash_t update_hash(node_t& board, chess_move& m);
+void set_bitboards(node_t& board);
+int castle_rights(const node_t& board);
+bool set_fen(node_t& board, const std::string& fen);
 bool in_check(const node_t& board, int s);
 bool attack(const node_t& board, int sq, int s);
-void gen(std::vector<chess_move>& workq, const node_t& board);
-void gen_caps(std::vector<chess_move>& workq, const node_t& board);
-void gen_push(std::vector<chess_move>& workq, const node_t& board, int from, int to, int bits);
-void gen_promote(std::vector<chess_move>& workq, int from, int to, int bits);
+void gen(move_list& workq, const node_t& board);
+void gen_caps(move_list& workq, const node_t& board);
+void gen_quiets(move_list& workq, const node_t& board);
+bool decode_move(const node_t& board, uint16_t mv, chess_move& m);
+bool workq_sort(const chess_move& m1, const chess_move& m2);
+int see(const node_t& board, chess_move& m);
+void gen_push(move_list& workq, const node_t& board, int from, int to, int bits);
+void gen_promote(move_list& workq, int from, int to, int bits);
 bool makemove(node_t& board, chess_move& m);
-void takeback(node_t& board);
+bool makemove(node_t& board, chess_move& m, undo_t& u);
+void unmakemove(node_t& board, const undo_t& u);
+void make_null(node_t& board, undo_t& u);
+void unmake_null(node_t& board, const undo_t& u);
+void takeback(node_t& board, std::vector<undo_t>& history);
 bool board_equals(const node_t& b1,const node_t& b2);
 #endif
@@ -31,7 +31,7 @@ class chess_move {
     uint8_t promote;
     uint8_t bits; // LSB
 public:
-    uint8_t score;
+    int32_t score;  // for move ordering, see gen_push()
 
     chess_move() : u(0), from(0), to(0), promote(0), bits(0), score(0) {}
     uint32_t get32BitMove() {
@@ -54,6 +54,12 @@ public:
         u = ((from & 0xFF) << 24) + ((to & 0xFF) << 16) + ((promote & 0xFF) << 8)
             + ((bits & 0xFF) << 0);
     }
+    /* A compact form of the chess_move for the transposition table.
+       It drops the bits field, so it has to be matched against a
+       generated chess_move rather than played directly. */
+    uint16_t get16BitMove() const {
+        return (from & 63) | ((to & 63) << 6) | ((promote & 7) << 12);
+    }
     uint8_t getFrom() { return from; }
     uint8_t getTo() { return to; }
     uint8_t getPromote() { return promote; }
@@ -26,6 +26,7 @@
 extern hash_t hash_piece[2][6][64];
 extern hash_t hash_side;
 extern hash_t hash_ep[64];
+extern hash_t hash_castle[4];
 extern int mailbox[120];
 extern int mailbox64[64];
 extern bool slide[6];
@@ -36,14 +37,25 @@ extern char piece_char[6];
 extern int init_color[64];
 extern int init_piece[64];
 extern int depth[2];
+extern int clock_ms[2];
+extern int inc_ms[2];
+extern int moves_to_go;
+extern int move_time_ms;
 extern int output;
 extern int chosen_evaluator;
 extern int search_method;
 extern int iter_depth;
-extern int rnum[];
+extern int aspiration_width;
+extern int mtdf_start_width;
+extern int mtdf_max_tries;
+extern int mtdf_grow_width;
+extern bool null_move_enabled;
+extern bool lmr_enabled;
 extern bool bench_mode;
 extern bool logging_enabled;
 extern int mpi_depth;
+extern int split_depth;
+extern int split_method;
 
 ////////////////////////////////////////////////////////////////////////////
 //State Information -- The global variables this program uses and modifies//
@@ -30,6 +30,11 @@
 #define MINIMAX         0
 #define ALPHABETA       1
 #define MTDF            2
+#define LAZYSMP         3
+
+// Parallel split Defs
+#define SPLIT_BATCH     0
+#define SPLIT_YBWC      1
 
 /* useful squares */
 #define A1_CHESS              56
@@ -49,6 +54,9 @@
 #define G8_CHESS              6
 #define H8_CHESS              7
 
+// deepest ply that gets its own killer moves and principal variation
+#define MAX_PLY         64
+
 #define ROW(x)          (x >> 3)
 #define COL(x)          (x & 7)
 
@@ -22,14 +22,42 @@
 #define ROOK_OPEN_FILE_BONUS        15
 #define ROOK_ON_SEVENTH_BONUS       20
 
+extern const int piece_value[6];
+extern const int pawn_pcsq[64];
+extern const int knight_pcsq[64];
+extern const int bishop_pcsq[64];
+extern const int flip[64];
+
+/* pcsq_value() is what a piece adds to base_node_t::pcsq on sq */
+inline int pcsq_value(int color, int piece, int sq)
+{
+    if (color == DARK)
+        sq = flip[sq];
+    switch (piece) {
+        case PAWN:
+            return pawn_pcsq[sq];
+        case KNIGHT:
+            return knight_pcsq[sq];
+        case BISHOP:
+            return bishop_pcsq[sq];
+    }
+    return 0;
+}
+
+/* eval() keeps the scores of eval_orig() in a cache; these count how
+   often this thread found one there */
+extern thread_local uint64_t eval_cache_hits;
+extern thread_local uint64_t eval_cache_misses;
+void clear_eval_cache();
+
 struct evaluator {
     int pawn_rank[2][10];
-    int piece_mat[2];  // the value of a side's pieces
-    int pawn_mat[2];  // the value of a side's pawns
+    int piece_mat[2];  // copied from the board for the king evaluation
 
     int eval(const node_t& board, int evaluator);
     int eval_simple(const node_t& board);
     int eval_orig(const node_t& board);
+    int eval_pawns(const node_t& board);
     int eval_light_pawn(int sq);
     int eval_dark_pawn(int sq);
     int eval_light_king(int sq);
@@ -10,6 +10,6 @@
 #include "parallel.hpp"
 #include <stdio.h>
 
-typedef uint32_t hash_t;
+typedef uint64_t hash_t;
 
 #endif
@@ -26,6 +26,13 @@ void serialize(Archive &ar, node_t& board, const unsigned int)
     ar & board.hash;
     ar & board.color;
     ar & board.piece;
+    ar & board.bb_color;
+    ar & board.bb_piece;
+    ar & board.king_sq;
+    ar & board.piece_mat;
+    ar & board.pawn_mat;
+    ar & board.pcsq;
+    ar & board.pawn_hash;
     ar & board.depth;
     ar & board.side;
     ar & board.castle;
@@ -36,7 +43,7 @@ void serialize(Archive &ar, node_t& board, const unsigned int)
     ar & board.hist_dat;
 }
 template <typename Archive>
-void serialize(Archive &ar, FixedVec<unsigned int, 50> vec, const unsigned int)
+void serialize(Archive &ar, FixedVec<hash_t, 50> vec, const unsigned int)
 {
     ar & vec.data;
     ar & vec._size;
@@ -15,12 +15,13 @@
 #include "data.hpp"
 #include "search.hpp"
 #include "chess_move.hpp"
+#include "move_list.hpp"
 
 int main(int argc, char *argv[]);
-int parse_move(std::vector<chess_move>& workq, const char *s);
+int parse_move(move_list& workq, const char *s);
 char *move_str(chess_move& m);
 void print_board(const node_t& board, std::ostream& out);
-int print_result(std::vector<chess_move>& workq, node_t& board);
+int print_result(move_list& workq, node_t& board);
 void start_benchmark(std::string filename, int ply_level, int num_runs,bool parallel);
 int get_ms();
 std::string get_log_name();
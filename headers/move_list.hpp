@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef MOVE_LIST_HPP
+#define MOVE_LIST_HPP
+#include <assert.h>
+#include <new>
+#include "chess_move.hpp"
+
+/**
+ * The moves of one position. No legal position has more than 218
+ * moves, so a fixed array of 256 is always enough, and it can live
+ * on the stack of the search function instead of the heap. The
+ * slots are left uninitialized until a chess_move is pushed, so
+ * declaring one costs nothing.
+ */
+class move_list {
+public:
+    static const int capacity = 256;
+    typedef chess_move *iterator;
+    typedef const chess_move *const_iterator;
+
+    move_list() : n(0) {}
+    move_list(const move_list& ml) : n(0) {
+        for (int i = 0; i < ml.n; i++)
+            push_back(ml[i]);
+    }
+    void operator=(const move_list& ml) {
+        n = 0;
+        for (int i = 0; i < ml.n; i++)
+            push_back(ml[i]);
+    }
+
+    void push_back(const chess_move& m) {
+        assert(n < capacity);
+        new (&data()[n++]) chess_move(m);
+    }
+    void clear() { n = 0; }
+    void truncate(size_t size) {
+        assert(size <= size_t(n));
+        n = size;
+    }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    chess_move& operator[](size_t i) {
+        assert(i < size_t(n));
+        return data()[i];
+    }
+    const chess_move& operator[](size_t i) const {
+        assert(i < size_t(n));
+        return data()[i];
+    }
+    chess_move& back() { return (*this)[n-1]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + n; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + n; }
+
+private:
+    int n;
+    alignas(chess_move) unsigned char storage[capacity*sizeof(chess_move)];
+
+    chess_move *data() { return reinterpret_cast<chess_move *>(storage); }
+    const chess_move *data() const { return reinterpret_cast<const chess_move *>(storage); }
+};
+
+#endif
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef MOVE_PICKER_HPP
+#define MOVE_PICKER_HPP
+#include "node.hpp"
+#include "chess_move.hpp"
+#include "move_list.hpp"
+
+/**
+ * What a thread learns about move ordering while it searches. The
+ * killers are the last two quiet moves that cut off the search at
+ * each ply, and history counts how often (weighted by depth) a quiet
+ * chess_move from one square to another has cut off anywhere in the
+ * tree. Each thread has a table of its own, so none of it needs
+ * locking (see get_order_table()).
+ */
+struct order_table {
+    int search_id;
+    uint16_t killers[MAX_PLY][2];
+    int history[64][64];
+
+    void clear();
+    void add_cutoff(int ply, int depth, chess_move& m);
+};
+
+/**
+ * Hands out the moves of a position one at a time, in the order
+ * alpha-beta wants to try them: the transposition table move, the
+ * captures and promotions (most valuable victim, least valuable
+ * attacker first), the killer moves, the quiet moves, and last the
+ * captures that lose material according to see(). Each stage is only
+ * generated once the one before it has run out, so a node that is
+ * cut off early never generates its quiet moves at all.
+ *
+ * The moves are pseudo-legal, like those of gen(), and none is
+ * handed out twice.
+ */
+class move_picker {
+public:
+    /* the killers and history come from order, which may be null */
+    move_picker(const node_t& board, uint16_t hash_move, const order_table *order);
+
+    bool next(chess_move& m);
+
+    /* whether the last chess_move handed out was one of the quiet
+       moves, after the hash move and the killers: the ones late move
+       reductions may be applied to */
+    bool late() const { return stage == QUIETS; }
+
+    /* Moves are generated from board when they are needed, so it
+       must be in the position we were made for whenever next() is
+       called. Before other threads call next() too, share() points
+       us at a copy of it, and lets go of the order table, which only
+       the thread that owns it may read. */
+    void share(const node_t& copy) {
+        board = &copy;
+        order = 0;
+    }
+
+private:
+    enum stage_t { HASH_MOVE, GEN_CAPTURES, CAPTURES, KILLERS,
+        GEN_QUIETS, QUIETS, BAD_CAPTURES, DONE };
+
+    const node_t *board;
+    const order_table *order;
+    stage_t stage;
+    uint16_t hash_move;
+    uint16_t killer[2];
+    size_t cur;
+    size_t nbad;  // the losing captures wait at the front of moves
+    move_list moves;
+};
+
+#endif
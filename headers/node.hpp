@@ -13,11 +13,23 @@
 #include "defs.hpp"
 #include "hash.hpp"
 #include "FixedVec.hpp"
+#include "bitboard.hpp"
 
 struct base_node_t { 
     hash_t hash;
     char color[64];
     char piece[64];
+    /* the same position as sets of squares, kept in step with
+       color[] and piece[] by makemove() and set_bitboards() */
+    bitboard_t bb_color[2];
+    bitboard_t bb_piece[6];
+    int king_sq[2];  // where each side's king is, or -1 if it has none
+    /* the terms of eval_orig() that depend on nothing but a piece and
+       its square, summed for each side and kept up the same way */
+    int piece_mat[2];  // the value of a side's pieces
+    int pawn_mat[2];  // the value of a side's pawns
+    int pcsq[2];  // the piece/square values of its pawns, knights and bishops
+    hash_t pawn_hash;  // the part of hash made up by the pawns
     int depth;
     int side;
     int castle;
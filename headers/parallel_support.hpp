@@ -14,42 +14,100 @@
 #include <boost/atomic.hpp>
 #include "parallel.hpp"
 #include <boost/shared_ptr.hpp>
-#include <future>
+#include "thread_pool.hpp"
 
 extern bool par_enabled;
 int chx_threads_per_proc();
 
 struct task;
 
+/**
+ * A principal variation: the best line found from a node, one chess_move
+ * per ply. Every search_info holds the one of its own node, made of the
+ * best chess_move and the line of the child it leads to, so together
+ * they form the usual triangular table, kept by whichever thread
+ * searches the node. Nothing in it is shared while it is being built.
+ */
+struct pv_line {
+    int length;
+    chess_move moves[MAX_PLY];
+
+    pv_line() : length(0) {}
+    void clear() { length = 0; }
+    /* makes the line m followed by rest */
+    void set(const chess_move& m, const pv_line& rest) {
+        moves[0] = m;
+        length = 1;
+        for (int i = 0; i < rest.length && length < MAX_PLY; i++)
+            moves[length++] = rest.moves[i];
+    }
+};
+
 struct search_info {
 private:
     boost::atomic<bool>  abort_flag_;
     boost::atomic<bool> *abort_flag;
+    search_info *abort_parent;  // aborting it aborts us too
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version) {
       // TODO: Write a real serializer
       abort();
     }
 public:
-    bool get_abort() { return *abort_flag; }
+    bool get_abort() {
+        for(search_info *s = this; s != 0; s = s->abort_parent)
+            if(*s->abort_flag)
+                return true;
+        return false;
+    }
     void set_abort(bool b) { *abort_flag = b; }
     void set_abort_ref(search_info *s) {
         abort_flag = s->abort_flag;
+        abort_parent = s->abort_parent;
+    }
+    /* Chains our abort flag to s, which must outlive us. A cutoff
+       anywhere up the chain then stops the whole subtree. */
+    void set_abort_parent(search_info *s) {
+        abort_parent = s;
     }
     node_t board;
+    /* A serial child doesn't get its own board: it searches its
+       parent's, which the parent has made the chess_move on and will
+       unmake afterwards. Only tasks that may run on another thread
+       need a copy in board. */
+    node_t *parent_board;
+    node_t& get_board() {
+        return parent_board ? *parent_board : board;
+    }
     bool par_done;
+    bool helper;  // a Lazy SMP helper, whose chess_move isn't played
+    bool after_null;  // reached by a null move, so it may not make another
     chess_move mv;
     score_t result;
     int depth;
     int incr;
     score_t alpha;
     score_t beta;
+    pv_line pv;  // filled in by the search
+    /* The principal variation of the last iteration, as long as the
+       moves leading here are the ones it starts with, otherwise null.
+       It is read by all threads, so nobody may change it during the
+       search. */
+    const pv_line *prev_pv;
 
-    search_info(const node_t& board_) : abort_flag_(false), abort_flag(&abort_flag_), board(board_),
-            result(bad_min_score) {
+    /* follow_pv() sets prev_pv for the child that parent reaches with
+       m at ply */
+    void follow_pv(const search_info *parent, const chess_move& m, int ply) {
+        const pv_line *p = parent->prev_pv;
+        prev_pv = (p != 0 && ply < p->length && p->moves[ply].get16BitMove() == m.get16BitMove()) ? p : 0;
     }
 
-    search_info() : abort_flag_(false), abort_flag(&abort_flag_) {
+    search_info(const node_t& board_) : abort_flag_(false), abort_flag(&abort_flag_), abort_parent(0), board(board_),
+            parent_board(0), helper(false), after_null(false), result(bad_min_score), prev_pv(0) {
+    }
+
+    search_info() : abort_flag_(false), abort_flag(&abort_flag_), abort_parent(0), parent_board(0), helper(false),
+            after_null(false), prev_pv(0) {
     }
 
     ~search_info() {
@@ -64,9 +122,9 @@ void search_pt(boost::shared_ptr<search_info>);
 void search_ab_pt(boost::shared_ptr<search_info>);
 void qeval_pt(boost::shared_ptr<search_info>);
 
-score_t search(boost::shared_ptr<search_info>);
-score_t search_ab(boost::shared_ptr<search_info>);
-score_t qeval(boost::shared_ptr<search_info>);
+score_t search(search_info *);
+score_t search_ab(search_info *);
+score_t qeval(search_info *);
 
 enum pfunc_v { no_f, search_f, search_ab_f, qeval_f };
 
@@ -85,31 +143,6 @@ struct task {
     virtual void join() = 0;
 };
 
-struct serial_task : public task {
-    bool joined;
-    serial_task(): joined(false) {}
-    ~serial_task() {
-        info = 0;
-    }
-
-    virtual void start() { }
-
-    virtual void join() {
-        if (joined)
-            return;
-        if(info.get() == nullptr)
-            return;
-        if(pfunc == search_f)
-            info->result = search(info);
-        else if(pfunc == search_ab_f)
-            info->result = search_ab(info);
-        else if(pfunc == qeval_f)
-            info->result = qeval(info);
-        else
-            abort();
-        joined = true;
-    }
-};
 class pcounter {
     boost::atomic<int> count;
     int max_count;
@@ -138,32 +171,29 @@ public:
 
 extern pcounter task_counter;
 
-struct thread_task : public task {
-    bool joined;
-    std::shared_future<void> th;
-    thread_task() : joined(true) {}
+struct thread_task : public task, public pool_job {
+    thread_task() {}
     ~thread_task() {
         info = 0;
     }
     virtual void start() {
-        joined = false;
         //assert(info.valid());
+        workers.submit(this);
+    }
+    virtual void join() {
+        workers.wait(this);
+    }
+    virtual void execute() {
         if(pfunc == search_f) {
-            th = std::async(std::launch::async,search_pt,info);
+            search_pt(info);
         } else if(pfunc == search_ab_f) {
-            th = std::async(std::launch::async,search_ab_pt,info);
+            search_ab_pt(info);
         } else if(pfunc == qeval_f) {
-            th = std::async(std::launch::async,qeval_pt,info);
+            qeval_pt(info);
         } else {
             abort();
         }
     }
-    virtual void join() {
-        if(joined)
-            return;
-        th.get();
-        joined = true;
-    }
 };
 
 #ifdef HPX_SUPPORT
@@ -0,0 +1,30 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PERFT_HPP
+#define PERFT_HPP
+#include <stdint.h>
+#include <string>
+#include "node.hpp"
+
+/**
+ * perft counts the leaf nodes of the legal move tree to a fixed depth.
+ * The counts are known for many positions, so it checks gen() and
+ * makemove() for correctness, and timing it measures their speed
+ * without the rest of the search getting in the way.
+ */
+uint64_t perft(node_t& board, int depth, bool use_hash);
+
+/* Runs perft with the root moves spread over the worker threads and
+   prints the time taken. With divide set, the count under each root
+   chess_move is printed as well. */
+uint64_t perft_root(const node_t& board, int depth, bool use_hash, bool divide);
+
+/* Runs every position of an EPD file with ";D<depth> <count>" fields
+   up to max_depth and reports any count that doesn't match. */
+bool perft_suite(const std::string& filename, int max_depth, bool use_hash);
+
+#endif
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef POOL_HPP
+#define POOL_HPP
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+/**
+ * The number of times this thread has called operator new. The
+ * global operator new is replaced to count them (see pool.cpp), so
+ * the benchmark can check that the search doesn't allocate per node.
+ */
+extern thread_local uint64_t heap_allocs;
+
+/**
+ * A free list of blocks of one size, one list per thread. A block
+ * freed on another thread than the one that allocated it simply
+ * joins that thread's list, so no locking is needed. Blocks go back
+ * on a list rather than to the heap, so once the search has run for
+ * a while it stops allocating altogether.
+ */
+template<size_t Size>
+class block_pool {
+    struct block {
+        block *next;
+    };
+    static thread_local block *free_list;
+public:
+    static void *get() {
+        block *b = free_list;
+        if (b == 0)
+            return ::operator new(Size < sizeof(block) ? sizeof(block) : Size);
+        free_list = b->next;
+        return b;
+    }
+    static void put(void *p) {
+        block *b = static_cast<block *>(p);
+        b->next = free_list;
+        free_list = b;
+    }
+};
+
+template<size_t Size>
+thread_local typename block_pool<Size>::block *block_pool<Size>::free_list = 0;
+
+/**
+ * An allocator that takes its memory from block_pool, for use with
+ * boost::allocate_shared. The object and its reference count then
+ * come from the pool together.
+ */
+template<class T>
+struct pool_allocator {
+    typedef T value_type;
+
+    pool_allocator() {}
+    template<class U>
+    pool_allocator(const pool_allocator<U>&) {}
+
+    T *allocate(size_t n) {
+        assert(n == 1);
+        return static_cast<T *>(block_pool<sizeof(T)>::get());
+    }
+    void deallocate(T *p, size_t) {
+        block_pool<sizeof(T)>::put(p);
+    }
+
+    template<class U>
+    struct rebind {
+        typedef pool_allocator<U> other;
+    };
+    template<class U>
+    bool operator==(const pool_allocator<U>&) const { return true; }
+    template<class U>
+    bool operator!=(const pool_allocator<U>&) const { return false; }
+};
+
+#endif
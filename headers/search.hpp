@@ -22,42 +22,61 @@
 #include "score.hpp"
 #include "parallel_support.hpp"
 #include "chess_move.hpp"
+#include "move_list.hpp"
+#include "move_picker.hpp"
 #include <boost/shared_ptr.hpp>
 
 int think(node_t& board,bool parallel);
-score_t search(boost::shared_ptr<search_info>);
-score_t search_ab(boost::shared_ptr<search_info>);
-score_t mtdf(const node_t& board,score_t f,int depth);
-score_t qeval(boost::shared_ptr<search_info>);
+score_t search(search_info *);
+score_t search_ab(search_info *);
+class move_timer;
+score_t iterate(node_t& board,const move_timer *timer);
+score_t aspiration(const node_t& board,score_t f,int depth,pv_line& pv);
+score_t mtdf(const node_t& board,score_t f,int depth,pv_line& pv);
+score_t qeval(search_info *);
 int reps(const node_t& board);
 bool compare_moves(chess_move a, chess_move b);
-void sort_pv(std::vector<chess_move>& workq, int ply);
+order_table& get_order_table();
 bool capture(const node_t& board,chess_move& g);
 boost::shared_ptr<task> parallel_task(int depth, bool *parallel);
 int min(int a,int b);
 int max(int a,int b);
 void xboard();
+void uci();
+
+/* set_search_stop(true) aborts the search think() is doing on another
+   thread, or the next one if none has started yet. think() clears it
+   when it returns; whoever starts a search on another thread should
+   clear it first too, in case it was set just as the last one ended. */
+void set_search_stop(bool stop);
+
+/* If set, called on the searching thread with every iteration that
+   iterate(), or the main thread of a Lazy SMP search, finishes. */
+extern void (*iteration_done)(int depth,score_t score,const pv_line& pv);
 
 extern Mutex mutex;
+extern thread_local uint64_t nodes_searched;
+extern boost::atomic<uint64_t> nodes_total;
+
+/* count_node() counts a node in this thread's nodes_searched, and
+   every NODE_BATCH of them in nodes_total, which all threads share.
+   Adding to it one node at a time would have them fight over it. */
+#define NODE_BATCH 1024
+inline void count_node()
+{
+    if ((++nodes_searched & (NODE_BATCH - 1)) == 0)
+        nodes_total.fetch_add(NODE_BATCH, boost::memory_order_relaxed);
+}
+
+/* The nodes all threads have searched, as far as they have added them
+   to nodes_total, and all of this thread's. */
+inline uint64_t all_nodes()
+{
+    return nodes_total.load(boost::memory_order_relaxed) + (nodes_searched & (NODE_BATCH - 1));
+}
 extern const int num_proc;
 
-struct safe_move {
-    Mutex mut;
-    chess_move mv;
-    safe_move() : mut(), mv() {}
-    safe_move(const safe_move& sm) : mut(), mv(sm.mv) {}
-    void set(chess_move mv_) {
-        ScopedLock s(mut);
-        mv = mv_;
-    }
-    chess_move get() {
-        ScopedLock s(mut);
-        chess_move m = mv;
-        return m;
-    }
-private:
-};
-extern std::vector<safe_move> pv;  // Principle Variation, used in iterative deepening
+extern pv_line pv;  // Principle Variation of the last think()
 
 #define PV_ON 1
 
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <boost/atomic.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "parallel.hpp"
+
+/**
+ * A unit of work for the thread pool. Whoever takes a job out of its
+ * deque runs it: either a worker that finds it there, or the thread
+ * that waits for it, so a job that nobody got to yet simply runs
+ * inline when it is joined.
+ */
+struct pool_job {
+    enum { idle, queued, running, done };
+    boost::atomic<int> state;
+    int slot;  // the deque it was pushed on
+
+    pool_job() : state(idle), slot(0) {}
+    virtual ~pool_job() {}
+
+    virtual void execute() = 0;
+
+    bool finished() {
+        return state.load(boost::memory_order_acquire) == done;
+    }
+};
+
+/**
+ * A fixed set of worker threads with one deque each. Jobs are pushed
+ * and popped at the back of the submitting thread's deque, so a thread
+ * works depth first on its own subtree, and idle workers steal from
+ * the front of other deques, where the biggest subtrees are. Threads
+ * that are not workers (the main thread) share deque 0.
+ */
+class thread_pool {
+    struct job_queue {
+        Mutex mut;
+        std::deque<pool_job *> jobs;
+    };
+    std::vector<std::thread> threads;
+    std::vector<job_queue *> queues;
+    boost::atomic<bool> stopping;
+    boost::atomic<int> pending;
+    std::mutex sleep_mut;
+    std::condition_variable wake;
+
+    void worker(int slot);
+    pool_job *find_job(int slot);
+    bool unqueue(pool_job *job);
+    static void run(pool_job *job);
+public:
+    thread_pool() : stopping(false), pending(0) {}
+    ~thread_pool() { stop(); }
+
+    void start(int nthreads);
+    void stop();
+    int size() const { return threads.size(); }
+
+    void submit(pool_job *job);
+    void wait(pool_job *job);
+};
+
+extern thread_pool workers;
+
+#endif
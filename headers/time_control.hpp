@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+#ifndef TIME_CONTROL_HPP
+#define TIME_CONTROL_HPP
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "parallel_support.hpp"
+
+/**
+ * Times one chess_move of think() against the clock in data.hpp. The
+ * budget for the chess_move comes from the time left and the increment,
+ * and has two limits. The soft limit is checked between iterations:
+ * once it has passed no deeper iteration is started, since it would
+ * most likely not finish anyway. At the hard limit a timer thread
+ * aborts the search wherever it is, and the chess_move of the last
+ * iteration that finished is played.
+ */
+class move_timer {
+public:
+    move_timer() : soft_ms(0), hard_ms(0), done(false) {}
+    ~move_timer() { stop(); }
+
+    /* Starts timing a chess_move for side, with stop as the search_info
+       to abort at the hard limit. Returns false, and times nothing,
+       if there is no clock. */
+    bool start(int side, search_info *stop);
+    /* Stops the timer thread, if it still runs. */
+    void stop();
+
+    int elapsed_ms() const;
+    bool past_soft_limit() const { return elapsed_ms() >= soft_ms; }
+
+private:
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start_time;
+    int soft_ms;
+    int hard_ms;
+    std::mutex mut;
+    std::condition_variable wake;
+    bool done;
+    std::thread thread;
+
+    void run(search_info *stop);
+};
+
+/* move_budget() works out the soft and hard limits for a chess_move of
+   side, in milliseconds. It returns false if there is no clock. */
+bool move_budget(int side, int& soft_ms, int& hard_ms);
+
+#endif
@@ -9,24 +9,57 @@
 #include "hash.hpp"
 #include "score.hpp"
 #include "node.hpp"
-#include <math.h>
-#include "parallel.hpp"
-
-const int table_size = 16*4096;
+#include "chess_move.hpp"
+#include <boost/atomic.hpp>
+#include <stddef.h>
 
+/**
+ * One slot of the transposition table. Slots are read and written
+ * without locks, so each one is just two 64-bit words:
+ *
+ *   scores: the lower bound in the high 32 bits, the upper bound
+ *           in the low 32 bits.
+ *   check:  the key (the high 32 bits of the position hash in the high 32 bits,
+ *           best chess_move, depth and generation in the low 32 bits)
+ *           xor'ed with the scores word.
+ *
+ * A reader xors the two words back together and only trusts the slot
+ * if the key matches. If another thread was halfway through writing
+ * the slot, the words come from different stores and the key will not
+ * match, so the probe is simply treated as a miss (Hyatt and Mann's
+ * lockless transposition table).
+ */
 struct zkey_t {
-  score_t lower, upper;
-  Mutex mut;
-  node_t board;
-  int depth;
-  zkey_t() : depth(-1) {
-  }
+    boost::atomic<uint64_t> check;
+    boost::atomic<uint64_t> scores;
+    zkey_t() : check(0), scores(0) {
+    }
+};
+
+/**
+ * The table is made of buckets that fill one cache line. A position
+ * always hashes to the same bucket, so a probe touches one line, and
+ * the same position can be stored at several depths side by side.
+ */
+const int bucket_slots = 4;
+
+struct alignas(64) zbucket_t {
+    zkey_t slot[bucket_slots];
 };
 
-extern zkey_t transposition_table[table_size];
+extern zbucket_t *transposition_table;
+extern size_t table_size;  // number of slots, always a power of two
+
+int chx_hash_mb();
+bool chx_huge_pages();
+bool resize_transposition_table(size_t mb,bool huge_pages);
+void clear_transposition_table();
+void age_transposition_table();
 
 bool get_transposition_value(const node_t& board,score_t& lower,score_t& upper);
 
-void set_transposition_value(const node_t& board,score_t lower,score_t upper);
+void set_transposition_value(const node_t& board,score_t lower,score_t upper,chess_move best);
+
+uint16_t get_transposition_move(const node_t& board);
 
 #endif
@@ -12,14 +12,231 @@
 #include <assert.h>
 #include "parallel.hpp"
 #include "zkey.hpp"
+#include "move_picker.hpp"
 #include <atomic>
 
 void search_ab_pt(boost::shared_ptr<search_info> info)
 {
-    info->result = search_ab(info);
+    info->result = search_ab(info.get());
     task_counter.add(1);
 }
 
+/* Null move pruning is only tried this many plies from the leaves. */
+#define NULL_MOVE_MIN_DEPTH 3
+
+/* Late move reductions: a quiet chess_move that comes this late in the
+   ordering, at a node this deep, is first searched with less depth. */
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+
+/* lmr_reduction() returns how many plies less the chess_move just made
+   on board may be searched with. late says whether the move_picker
+   handed it out with the quiet moves, and in_check whether the side
+   that made it was in check. */
+
+static int lmr_reduction(const node_t& board,int depth,int moves,bool late,bool in_check_)
+{
+    if (!lmr_enabled || !late || in_check_ || depth < LMR_MIN_DEPTH || moves < LMR_MIN_MOVES)
+        return 0;
+    // checks are left alone, they are rarely quiet
+    if (in_check(board, board.side))
+        return 0;
+    int r = 1;
+    if (moves >= 4*LMR_MIN_MOVES && depth >= 2*LMR_MIN_DEPTH)
+        r = 2;
+    return r;
+}
+
+/* search_child() searches a child that has been set up on its
+   parent's board with the full depth and window. With reduce > 0 it
+   first tries a search that much shallower, with a null window at the
+   parent's alpha, and only searches again in full if the chess_move
+   turns out to raise alpha after all. */
+
+static void search_child(search_info *child_info,int reduce)
+{
+    node_t& board = child_info->get_board();
+    const int depth = child_info->depth;
+    if (reduce > 0) {
+        const score_t alpha = child_info->alpha;
+        const score_t beta = child_info->beta;
+        board.depth = child_info->depth = depth - reduce;
+        child_info->alpha = beta - 1;
+        child_info->result = search_ab(child_info);
+        if (child_info->get_abort() || child_info->result >= beta)
+            return;
+        board.depth = child_info->depth = depth;
+        child_info->alpha = alpha;
+    }
+    child_info->result = search_ab(child_info);
+}
+
+/* Two moves can have the same exact score where their lines transpose
+   into the same leaf. Which of them is found first depends on the
+   thread timing and on the history tables, so at the root the chess_move
+   played would vary from run to run. There each chess_move is searched
+   with alpha one below the best score so far, so that a tie comes back
+   exact, and root_tie() gives a tie to the lower chess_move code.
+   child_info is the child that scored val, against the best max_val. */
+static bool root_tie(const node_t& board,score_t val,score_t max_val,
+    const search_info& child_info,const chess_move& max_move)
+{
+    return board.ply == 0 && val == max_val && val > -child_info.beta
+        && child_info.mv.get16BitMove() < max_move.get16BitMove();
+}
+
+/**
+ * A split point for the Young Brothers Wait search. Once the eldest
+ * brother has been searched, the remaining moves of a node are shared
+ * here: the owner and any helpers that join take the next unsearched
+ * move from the picker in turn and merge their results under the lock. A cutoff sets
+ * the abort flag in info, which every subtree searched from the split
+ * point is chained to. Helpers start from their own copy of board,
+ * the owner keeps using its own.
+ */
+struct split_point {
+    Mutex mut;
+    search_info info;  // its pv is the node's, until the split is over
+    const search_info *owner;
+    node_t board;
+    move_picker *picker;
+    int depth;
+    bool in_check;  // the side to move at the node
+    boost::atomic<int> moves;  // legal ones searched so far
+    score_t alpha;
+    score_t beta;
+    score_t max_val;
+    chess_move max_move;
+};
+
+/* ybwc_search() searches moves of the split point until there are
+   none left or the node is cut off, making and unmaking them on board.
+   With eldest set it returns after the first legal chess_move, so the
+   bound is known before the split. */
+
+void ybwc_search(split_point *sp,node_t& board,bool eldest)
+{
+    for(;;) {
+        chess_move g;
+        search_info child_info;
+        bool late;
+        {
+            ScopedLock l(sp->mut);
+            if(sp->info.get_abort() || !sp->picker->next(g))
+                return;
+            child_info.alpha = -sp->beta;
+            child_info.beta = (board.ply == 0) ? -(sp->alpha - 1) : -sp->alpha;
+            late = sp->picker->late();
+        }
+        undo_t u;
+        if(!makemove(board, g, u))
+            continue;
+        // counted like the serial loop does, so LMR starts as late
+        const int moves = sp->moves++;
+        child_info.set_abort_parent(&sp->info);
+        child_info.follow_pv(sp->owner, g, board.ply-1);
+        child_info.parent_board = &board;
+        board.depth = child_info.depth = sp->depth-1;
+        child_info.mv = g;
+        if(sp->depth == 1 && capture(board,g))
+            child_info.result = qeval(&child_info);
+        else
+            search_child(&child_info,
+                lmr_reduction(board, sp->depth, moves, late, sp->in_check));
+        unmakemove(board, u);
+        board.depth = sp->depth;
+        if(child_info.get_abort())
+            return;
+        score_t val = -child_info.result;
+        {
+            ScopedLock l(sp->mut);
+            if (root_tie(board, val, sp->max_val, child_info, sp->max_move)) {
+                sp->max_move = g;
+#ifdef PV_ON
+                if (sp->info.pv.length > 0)
+                    sp->info.pv.set(g, child_info.pv);
+#endif
+            } else if (val > sp->max_val) {
+                sp->max_val = val;
+                sp->max_move = g;
+                if (val > sp->alpha) {
+                    sp->alpha = val;
+#ifdef PV_ON
+                    sp->info.pv.set(g, child_info.pv);
+#endif
+                    if (sp->alpha >= sp->beta) {
+                        sp->info.set_abort(true);
+                        get_order_table().add_cutoff(board.ply, sp->depth, g);
+                    }
+                }
+            }
+        }
+        if(eldest)
+            return;
+    }
+}
+
+struct ybwc_job : public pool_job {
+    split_point *sp;
+    void execute() {
+        node_t board = sp->board;
+        ybwc_search(sp, board, false);
+        task_counter.add(1);
+    }
+};
+
+/* Searches the moves of a node the Young Brothers Wait way: the first
+   legal chess_move on this thread, then, unless it cut off, the rest
+   at a split point that idle threads may join. */
+
+void search_ab_ybwc(search_info *proc_info,node_t& board,
+    move_picker& picker,bool in_check_,score_t& alpha,score_t beta,
+    score_t& max_val,chess_move& max_move)
+{
+    split_point sp;
+    sp.info.set_abort_parent(proc_info);
+    sp.owner = proc_info;
+    sp.picker = &picker;
+    sp.depth = proc_info->depth;
+    sp.in_check = in_check_;
+    sp.moves = 0;
+    sp.alpha = alpha;
+    sp.beta = beta;
+    sp.max_val = max_val;
+    sp.max_move = max_move;
+
+    ybwc_search(&sp, board, true);
+
+    size_t n = 0;
+#ifndef HPX_SUPPORT
+    // We don't know how many moves are left without generating
+    // them, so every idle thread is welcome.
+    if(sp.depth >= split_depth && search_method != LAZYSMP
+            && !sp.info.get_abort())
+        n = workers.size();
+#endif
+    std::vector<ybwc_job> helpers(n);
+    size_t started = 0;
+    if(n > 0) {
+        // the picker may generate moves while our board is in a child
+        sp.board = board;
+        picker.share(sp.board);
+    }
+    while(started < n && task_counter.dec() > 0) {
+        helpers[started].sp = &sp;
+        workers.submit(&helpers[started++]);
+    }
+    ybwc_search(&sp, board, false);
+    for(size_t i = 0; i < started; i++)
+        workers.wait(&helpers[i]);
+
+    alpha = sp.alpha;
+    max_val = sp.max_val;
+    max_move = sp.max_move;
+    if(sp.info.pv.length > 0)
+        proc_info->pv = sp.info.pv;
+}
+
 #define WHEN 1
 struct When {
 //#ifdef HPX_SUPPORT
@@ -51,16 +268,18 @@ struct When {
 #endif
 };
 
-score_t search_ab(boost::shared_ptr<search_info> proc_info)
+score_t search_ab(search_info *proc_info)
 {
     if(proc_info->get_abort())
         return bad_min_score;
+    count_node();
     // Unmarshall the info struct
-    node_t board = proc_info->board;
+    node_t& board = proc_info->get_board();
     int depth = proc_info->depth;
     score_t alpha = proc_info->alpha;
     score_t beta = proc_info->beta;
     assert(depth >= 0);
+    proc_info->pv.clear();
     // if we are a leaf node, return the value from the eval() function
     if (depth == 0)
     {
@@ -101,51 +320,146 @@ score_t search_ab(boost::shared_ptr<search_info> proc_info)
         return alpha;
     }
 
-    std::vector<chess_move> workq;
+    const bool check = in_check(board, board.side);
+
+    /* Null move pruning: if we could pass and still have a score of
+       beta or more in a shallower search, a real chess_move will almost
+       surely do as well, so the node is cut off without searching any.
+       Not with only pawns left, where zugzwang is common enough that
+       passing may be the best there is, nor in check, nor right after
+       another null move. */
+    if (null_move_enabled && depth >= NULL_MOVE_MIN_DEPTH && board.ply > 0
+            && !check && !proc_info->after_null && board.piece_mat[board.side] > 0) {
+        evaluator ev;
+        DECL_SCORE(s,ev.eval(board, chosen_evaluator),board.hash);
+        if (s >= beta) {
+            const int reduce = (depth > 6) ? 3 : 2;
+            undo_t u;
+            make_null(board, u);
+            search_info null_info;
+            null_info.set_abort_parent(proc_info);
+            null_info.parent_board = &board;
+            null_info.after_null = true;
+            board.depth = null_info.depth = max(depth - 1 - reduce, 0);
+            null_info.alpha = -beta;
+            null_info.beta = -beta + 1;
+            score_t null_val = (null_info.depth == 0) ? qeval(&null_info) : search_ab(&null_info);
+            unmake_null(board, u);
+            board.depth = depth;
+            if (proc_info->get_abort())
+                return bad_min_score;
+            if (-null_val >= beta)
+                return -null_val;
+        }
+    }
+
     chess_move max_move;
     max_move = INVALID_MOVE; 
 
-    gen(workq, board); // Generate the moves
-
+    /* The moves are generated as we go, best first. On the principal
+       variation of the last iteration its chess_move goes first, even if
+       the transposition table has forgotten it. */
+    uint16_t first_move = 0;
 #ifdef PV_ON
-    sort_pv(workq, board.ply); // Part of iterative deepening
+    if (proc_info->prev_pv != 0 && board.ply < proc_info->prev_pv->length)
+        first_move = proc_info->prev_pv->moves[board.ply].get16BitMove();
 #endif
+    if (first_move == 0)
+        first_move = get_transposition_move(board);
+    move_picker picker(board, first_move, &get_order_table());
 
-    const int worksq = workq.size();
     std::vector<boost::shared_ptr<task> > tasks;
 
-    int j=0;
-    score_t val;
-
+    bool more = true;
     bool aborted = false;
     bool children_aborted = false;
-    // loop through the moves
-    //for (; j < worksq; j++) {
-    while(j < worksq) {
-        while(j < worksq) {
-            chess_move g = workq[j++];
 
-            boost::shared_ptr<search_info> child_info{new search_info(board)};
+    // merge() takes the result of a finished child into our bounds
+    auto merge = [&](search_info *child_info) {
+        if(child_info->get_abort())
+            return;
+        score_t val = -child_info->result;
+        if (root_tie(board, val, max_val, *child_info, max_move)) {
+            max_move = child_info->mv;
+#ifdef PV_ON
+            if (proc_info->pv.length > 0)
+                proc_info->pv.set(child_info->mv, child_info->pv);
+#endif
+        } else if (val > max_val) {
+            max_val = val;
+            max_move = child_info->mv;
+            if (val > alpha) {
+                alpha = val;
+#ifdef PV_ON
+                proc_info->pv.set(child_info->mv, child_info->pv);
+#endif
+                if(alpha >= beta) {
+                    aborted = true;
+                    get_order_table().add_cutoff(board.ply, depth, max_move);
+                }
+            }
+        }
+    };
+
+    if (split_method == SPLIT_YBWC) {
+        search_ab_ybwc(proc_info, board, picker, check, alpha, beta, max_val, max_move);
+        more = false;
+    }
+    // loop through the moves
+    chess_move g;
+    int moves = 0;  // legal ones searched so far
+    while(more) {
+        while((more = picker.next(g))) {
+            if (aborted || proc_info->get_abort())
+                break;
 
             bool parallel;
-            if (!aborted && !proc_info->get_abort() && makemove(child_info->board, g)) {
+            undo_t u;
+            const bool late = picker.late();
+            if (makemove(board, g, u)) {
+                const int searched = moves++;
 
-                parallel = j > 0 && !capture(board,g);
+                parallel = !capture(board,g);
                 boost::shared_ptr<task> t = parallel_task(depth, &parallel);
 
-                t->info = child_info;
-                t->info->board.depth = child_info->depth = depth-1;
+                search_info serial_info;
+                search_info *child_info = t ? t->info.get() : &serial_info;
+                child_info->set_abort_parent(proc_info);
+                board.depth = child_info->depth = depth-1;
                 assert(depth >= 0);
-                t->info->alpha = -beta;
-                t->info->beta = -alpha;
-                t->info->result = -beta;
-                t->info->mv = g;
+                child_info->alpha = -beta;
+                // board is at the child's ply now; see root_tie()
+                child_info->beta = (board.ply == 1) ? -(alpha - 1) : -alpha;
+                child_info->result = -beta;
+                child_info->mv = g;
+                child_info->follow_pv(proc_info, g, board.ply-1);
+                pfunc_v pfunc = search_ab_f;
                 if(depth == 1 && capture(board,g))
-                    t->pfunc = qeval_f;
-                else
-                    t->pfunc = search_ab_f;
-                t->start();
-                tasks.push_back(t);
+                    pfunc = qeval_f;
+                if (t) {
+                    // it may run on another thread, so it needs a board of its own
+                    child_info->board = board;
+                    t->pfunc = pfunc;
+                    t->start();
+                    tasks.push_back(t);
+                    unmakemove(board, u);
+                    board.depth = depth;
+                } else {
+                    child_info->parent_board = &board;
+                    if(pfunc == qeval_f)
+                        child_info->result = qeval(child_info);
+                    else
+                        search_child(child_info,
+                            lmr_reduction(board, depth, searched, late, check));
+                    unmakemove(board, u);
+                    board.depth = depth;
+                    merge(child_info);
+                    if(aborted && !children_aborted) {
+                        for(unsigned int m = 0;m < tasks.size();m++)
+                            tasks[m]->info->set_abort(true);
+                        children_aborted = true;
+                    }
+                }
 
                 // Control branching
                 if (!parallel)
@@ -167,7 +481,7 @@ score_t search_ab(boost::shared_ptr<search_info> proc_info)
             boost::shared_ptr<task> child_task = tasks[n];
             //assert(child_task.valid());
             child_task->join();
-            boost::shared_ptr<search_info> child_info = child_task->info;
+            search_info *child_info = child_task->info.get();
 
             tasks.erase(tasks.begin()+n);
 
@@ -178,33 +492,17 @@ score_t search_ab(boost::shared_ptr<search_info> proc_info)
                 children_aborted = true;
             }
 
-            child_task->join();
-            if(child_info->get_abort()) 
-                continue;
-            val = -child_info->result;
-
-            if (val > max_val) {
-                max_val = val;
-                max_move = child_info->mv;
-                if (val > alpha)
-                {
-                    alpha = val;
-#ifdef PV_ON
-                    if(!child_info->get_abort())
-                        pv[board.ply].set(child_info->mv);
-#endif
-                    if(alpha >= beta) {
-                        aborted = true;
-                        continue;
-                    }
-                }
-            }
+            merge(child_info);
         }
-        if(alpha >= beta) {
+        if(alpha >= beta || proc_info->get_abort()) {
             break;
         }
     }
 
+    // a cutoff above us; what we have is incomplete, so don't keep it
+    if (proc_info->get_abort())
+        return max_val;
+
     // no legal moves? then we're in checkmate or stalemate
     if (max_move == INVALID_MOVE) {
         if (in_check(board, board.side))
@@ -219,7 +517,7 @@ score_t search_ab(boost::shared_ptr<search_info> proc_info)
         }
     }
 
-    if (board.ply == 0) {
+    if (board.ply == 0 && !proc_info->helper) {
         assert(max_move != INVALID_MOVE);
         ScopedLock s(mutex);
         move_to_make = max_move;
@@ -233,7 +531,8 @@ score_t search_ab(boost::shared_ptr<search_info> proc_info)
 
     set_transposition_value(board,
         max(zlo,max_val >= beta  ? max_val : bad_min_score),
-        min(zhi,max_val < alpha ? max_val : bad_max_score));
+        min(zhi,max_val < alpha ? max_val : bad_max_score),
+        max_move);
 
 
     return max_val;
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  bitboard.cpp
+ */
+
+#include "bitboard.hpp"
+#include "defs.hpp"
+#include <string.h>
+
+bitboard_t knight_attacks[64];
+bitboard_t king_attacks[64];
+bitboard_t pawn_attacks[2][64];
+magic_t bishop_magic[64];
+magic_t rook_magic[64];
+
+static bitboard_t bishop_table[0x1480];
+static bitboard_t rook_table[0x19000];
+
+static const int bishop_dirs[4][2] = { {-1,-1}, {-1,1}, {1,-1}, {1,1} };
+static const int rook_dirs[4][2] = { {-1,0}, {1,0}, {0,-1}, {0,1} };
+
+/* step() returns the square dr rows and dc columns away from sq,
+   or -1 if that is off the board. */
+
+static int step(int sq, int dr, int dc)
+{
+    int r = ROW(sq) + dr;
+    int c = COL(sq) + dc;
+    if (r < 0 || r > 7 || c < 0 || c > 7)
+        return -1;
+    return r*8 + c;
+}
+
+/* slide() computes the attacks of a slider the slow way, walking
+   each ray until it leaves the board or hits an occupied square.
+   It is only used to fill the tables. */
+
+static bitboard_t slide(int sq, bitboard_t occ, const int dirs[4][2])
+{
+    bitboard_t b = 0;
+    for (int i = 0; i < 4; ++i) {
+        for (int n = step(sq, dirs[i][0], dirs[i][1]); n != -1;
+                n = step(n, dirs[i][0], dirs[i][1])) {
+            b |= square_bb(n);
+            if (occ & square_bb(n))
+                break;
+        }
+    }
+    return b;
+}
+
+/* The magics are found at startup by trying random sparse numbers
+   until one maps every occupancy to a slot that holds the right
+   attacks. The generator is seeded, so the search always ends up
+   with the same magics and takes a few milliseconds. */
+
+static uint64_t magic_seed = 1070372;
+
+static uint64_t magic_rand()
+{
+    magic_seed ^= magic_seed >> 12;
+    magic_seed ^= magic_seed << 25;
+    magic_seed ^= magic_seed >> 27;
+    return magic_seed * 2685821657736338717ULL;
+}
+
+static void init_magics(magic_t magics[64], bitboard_t *table, const int dirs[4][2])
+{
+    static bitboard_t occupancy[4096], reference[4096];
+    static int epoch[4096];
+    int attempt = 0;
+    memset(epoch, 0, sizeof(epoch));
+
+    for (int sq = 0; sq < 64; ++sq) {
+        magic_t& m = magics[sq];
+
+        // The edges only block rays that are already at their end,
+        // so they are left out of the mask (unless we are on them).
+        bitboard_t edges = ((0xFFULL | (0xFFULL << 56)) & ~(0xFFULL << (8*ROW(sq))))
+                         | ((0x0101010101010101ULL | (0x0101010101010101ULL << 7))
+                            & ~(0x0101010101010101ULL << COL(sq)));
+        m.mask = slide(sq, 0, dirs) & ~edges;
+        m.shift = 64 - __builtin_popcountll(m.mask);
+        m.attacks = table;
+
+        // Enumerate every subset of the mask (Carry-Rippler)
+        int size = 0;
+        bitboard_t b = 0;
+        do {
+            occupancy[size] = b;
+            reference[size] = slide(sq, b, dirs);
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+
+        for (int i = 0; i < size; ) {
+            do
+                m.magic = magic_rand() & magic_rand() & magic_rand();
+            while (__builtin_popcountll((m.magic * m.mask) >> 56) < 6);
+            ++attempt;
+            for (i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+        table += size;
+    }
+}
+
+void init_bitboards()
+{
+    static const int knight_steps[8][2] = {
+        {-2,-1}, {-2,1}, {-1,-2}, {-1,2}, {1,-2}, {1,2}, {2,-1}, {2,1} };
+    static const int king_steps[8][2] = {
+        {-1,-1}, {-1,0}, {-1,1}, {0,-1}, {0,1}, {1,-1}, {1,0}, {1,1} };
+
+    for (int sq = 0; sq < 64; ++sq) {
+        knight_attacks[sq] = 0;
+        king_attacks[sq] = 0;
+        for (int i = 0; i < 8; ++i) {
+            int n = step(sq, knight_steps[i][0], knight_steps[i][1]);
+            if (n != -1)
+                knight_attacks[sq] |= square_bb(n);
+            n = step(sq, king_steps[i][0], king_steps[i][1]);
+            if (n != -1)
+                king_attacks[sq] |= square_bb(n);
+        }
+        // LIGHT pawns move towards row 0, DARK pawns towards row 7
+        pawn_attacks[LIGHT][sq] = 0;
+        pawn_attacks[DARK][sq] = 0;
+        for (int dc = -1; dc <= 1; dc += 2) {
+            int n = step(sq, -1, dc);
+            if (n != -1)
+                pawn_attacks[LIGHT][sq] |= square_bb(n);
+            n = step(sq, 1, dc);
+            if (n != -1)
+                pawn_attacks[DARK][sq] |= square_bb(n);
+        }
+    }
+    init_magics(bishop_magic, bishop_table, bishop_dirs);
+    init_magics(rook_magic, rook_table, rook_dirs);
+}
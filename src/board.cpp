@@ -10,10 +10,12 @@
 
 
 #include "board.hpp"
+#include "eval.hpp"
 #include "here.hpp"
 #include <string.h>
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 // Make sure hashing works. Note
 // that the test is not thread safe.
@@ -38,6 +40,139 @@ void init_board(node_t& board)
     board.hist_dat.resize(10);
     // init_hash() must be called before this function
     board.hash = set_hash(board);  
+    set_bitboards(board);
+}
+
+/* set_bitboards() builds the bitboards, king squares, material
+   sums and pawn hash from color[] and piece[]. Call it whenever a position is set
+   up square by square. */
+
+void set_bitboards(node_t& board)
+{
+    board.bb_color[LIGHT] = board.bb_color[DARK] = 0;
+    for (int p = 0; p < 6; ++p)
+        board.bb_piece[p] = 0;
+    board.king_sq[LIGHT] = board.king_sq[DARK] = -1;
+    for (int c = 0; c < 2; ++c)
+        board.piece_mat[c] = board.pawn_mat[c] = board.pcsq[c] = 0;
+    board.pawn_hash = 0;
+    for (int i = 0; i < 64; ++i)
+        if (board.color[i] != EMPTY) {
+            const int c = board.color[i];
+            const int p = board.piece[i];
+            board.bb_color[c] |= square_bb(i);
+            board.bb_piece[p] |= square_bb(i);
+            if (p == KING)
+                board.king_sq[c] = i;
+            if (p == PAWN) {
+                board.pawn_mat[c] += piece_value[PAWN];
+                board.pawn_hash ^= hash_piece[c][PAWN][i];
+            }
+            else
+                board.piece_mat[c] += piece_value[p];
+            board.pcsq[c] += pcsq_value(c, p, i);
+        }
+}
+
+/* castle_rights() returns the castle bits a position set up square by
+   square can have: a side may only castle if its king and the rook
+   are still on their starting squares. */
+
+int castle_rights(const node_t& board)
+{
+    int castle = 0;
+    if (board.king_sq[LIGHT] == E1_CHESS) {
+        if (board.color[H1_CHESS] == LIGHT && board.piece[H1_CHESS] == ROOK)
+            castle |= 1;
+        if (board.color[A1_CHESS] == LIGHT && board.piece[A1_CHESS] == ROOK)
+            castle |= 2;
+    }
+    if (board.king_sq[DARK] == E8_CHESS) {
+        if (board.color[H8_CHESS] == DARK && board.piece[H8_CHESS] == ROOK)
+            castle |= 4;
+        if (board.color[A8_CHESS] == DARK && board.piece[A8_CHESS] == ROOK)
+            castle |= 8;
+    }
+    return castle;
+}
+
+/* set_fen() sets up the position given in Forsyth-Edwards Notation.
+   The half-move clock and chess_move number may be left out. Returns
+   false (leaving the board in some unspecified state) if the FEN
+   can't be read. */
+
+bool set_fen(node_t& board, const std::string& fen)
+{
+    std::istringstream in(fen);
+    std::string placement, side, castle, ep;
+    int fifty = 0;
+    if (!(in >> placement >> side >> castle >> ep))
+        return false;
+    in >> fifty;
+
+    init_board(board);
+    int sq = 0;
+    for (size_t i = 0; i < placement.size(); ++i) {
+        char c = placement[i];
+        if (c == '/')
+            continue;
+        if (c >= '1' && c <= '8') {
+            for (int n = c - '0'; n > 0 && sq < 64; --n, ++sq) {
+                board.color[sq] = EMPTY;
+                board.piece[sq] = EMPTY;
+            }
+            continue;
+        }
+        int p = std::find(piece_char, piece_char + 6, toupper(c)) - piece_char;
+        if (p == 6 || sq >= 64)
+            return false;
+        board.color[sq] = isupper(c) ? LIGHT : DARK;
+        board.piece[sq] = p;
+        ++sq;
+    }
+    if (sq != 64)
+        return false;
+
+    board.side = (side == "b") ? DARK : LIGHT;
+    board.castle = 0;
+    for (size_t i = 0; i < castle.size(); ++i) {
+        switch (castle[i]) {
+            case 'K': board.castle |= 1; break;
+            case 'Q': board.castle |= 2; break;
+            case 'k': board.castle |= 4; break;
+            case 'q': board.castle |= 8; break;
+        }
+    }
+    board.ep = -1;
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] >= '1' && ep[1] <= '8')
+        board.ep = (8 - (ep[1] - '0'))*8 + (ep[0] - 'a');
+    board.fifty = fifty;
+    board.ply = 0;
+    board.hply = 0;
+    set_bitboards(board);
+    board.castle &= castle_rights(board);
+    board.hash = set_hash(board);
+    return board.king_sq[LIGHT] != -1 && board.king_sq[DARK] != -1;
+}
+
+/* toggle() adds or removes a piece in the bitboards and the hash,
+   and in the material and piece/square sums and the pawn hash that
+   eval_orig() starts from */
+
+static inline void toggle(node_t& board, int color, int piece, int sq)
+{
+    // if the square is already ours, the piece is being taken off
+    const int sign = (board.bb_color[color] & square_bb(sq)) ? -1 : 1;
+    board.bb_color[color] ^= square_bb(sq);
+    board.bb_piece[piece] ^= square_bb(sq);
+    board.hash ^= hash_piece[color][piece][sq];
+    if (piece == PAWN) {
+        board.pawn_mat[color] += sign*piece_value[PAWN];
+        board.pawn_hash ^= hash_piece[color][PAWN][sq];
+    }
+    else
+        board.piece_mat[color] += sign*piece_value[piece];
+    board.pcsq[color] += sign*pcsq_value(color, piece, sq);
 }
 
 bool board_equals(const node_t& b1,const node_t& b2) {
@@ -65,27 +200,38 @@ void init_hash()
     hash_side = hash_rand();
     for (i = 0; i < 64; ++i)
         hash_ep[i] = hash_rand();
+    for (i = 0; i < 4; ++i)
+        hash_castle[i] = hash_rand();
 }
    
-static int hash_index = 0;
+/* hash_rand() returns the next number of a xorshift sequence with a
+   fixed seed, so the keys are the same on every system and in every
+   run, and the search is just as deterministic as with a table of
+   numbers. */
 
 hash_t hash_rand()
 {
-    return rnum[hash_index++];
+    static uint64_t x = 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1DULL;
 }
 
 
 /* set_hash() uses the Zobrist method of generating a unique number (hash)
    for the current chess position. Of course, there are many more chess
-   positions than there are 32 bit numbers, so the numbers generated are
+   positions than there are 64 bit numbers, so the numbers generated are
    not really unique, but they're unique enough for our purposes (to detect
    repetitions of the position). 
    The way it works is to XOR random numbers that correspond to features of
    the position, e.g., if there's a black knight on B8_CHESS, hash is XORed with
    hash_piece[BLACK][KNIGHT][B8_CHESS]. All of the pieces are XORed together,
-   hash_side is XORed if it's black's chess_move, and the en passant square is
-   XORed if there is one. (A chess technicality is that one position can't
-   be a repetition of another if the en passant state is different.) */
+   hash_side is XORed if it's black's chess_move, and the en passant square and
+   each castle right are XORed if there are any. (A chess technicality is that
+   one position can't be a repetition of another if the en passant state or
+   the castle rights are different.) makemove() keeps the hash up to date
+   the same way, one change at a time. */
 
 hash_t set_hash(node_t& board)
 {
@@ -99,175 +245,213 @@ hash_t set_hash(node_t& board)
         hash ^= hash_side;
     if (board.ep != -1)
         hash ^= hash_ep[board.ep];
+    for (i = 0; i < 4; ++i)
+        if (board.castle & (1 << i))
+            hash ^= hash_castle[i];
 
     return hash;
 }
 
-/*  
-    This is the function for updating the hash instead of recomputing it based on a chess_move.
-
-    For instance, if a pawn on a chessboard square is replaced by a rook from another square, 
-    the resulting position would be produced by XORing the existing hash like this:
-       0) XOR out the pawn at the destination square
-       1) XOR in the rook at the destination square
-       2) XOR out the rook from the source square
-    
-    Also because the chess_move changes the side of the player, we will XOR the hash_side.
-    This function is called at the beginning of makemove()
-*/
-hash_t update_hash(node_t& board, chess_move& m)
-{
-  /* m.from contains the location of the 'rook'
-     m.to contains the location of the 'pawn'
-     hash_piece[][][] is indexed by piece [color][type][square] */
-  hash_t hash(board.hash);
-  if (board.color[m.getTo()] != EMPTY)
-    hash ^= hash_piece[(size_t)board.color[m.getTo()]][(size_t)board.piece[m.getTo()]][m.getTo()];    // XOR out the 'pawn' from the destination square (or skip if empty)
-  hash ^= hash_piece[(size_t)board.color[m.getFrom()]][(size_t)board.piece[m.getFrom()]][m.getTo()];  // XOR in the 'rook' at the destination square
-  hash ^= hash_piece[(size_t)board.color[m.getFrom()]][(size_t)board.piece[m.getFrom()]][m.getFrom()];  // XOR out the 'rook' from the source square
-  
-  hash ^= hash_side;
-  
-  return hash;
-}
 
 
 /* in_check() returns TRUE if side s is in check and FALSE
-   otherwise. It just scans the board to find side s's king
-   and calls attack() to see if it's being attacked. */
+   otherwise. It calls attack() to see if side s's king is
+   being attacked. */
 
 bool in_check(const node_t& board, int s)
 {
-    int i;
-
-    for (i = 0; i < 64; ++i)
-        if (board.piece[i] == KING && board.color[i] == s)
-            return attack(board, i, s ^ 1);
-    assert(false);
-    return true;  /* shouldn't get here */
+    assert(board.king_sq[s] != -1);
+    if (board.king_sq[s] == -1)
+        return true;  /* shouldn't get here */
+    return attack(board, board.king_sq[s], s ^ 1);
 }
 
 
 /* attack() returns TRUE if square sq is being attacked by side
-   s and FALSE otherwise. */
+   s and FALSE otherwise. Rather than looking at every piece of
+   side s, it looks from sq outwards: a knight attacks sq if a
+   knight on sq would attack it, and so on. */
 
 bool attack(const node_t& board, int sq, int s)
 {
-    int i, j, n;
-
-    for (i = 0; i < 64; ++i)
-        if (board.color[i] == s) {
-            if (board.piece[i] == PAWN) {
-                if (s == LIGHT) {
-                    if (COL(i) != 0 && i - 9 == sq)
-                        return true;
-                    if (COL(i) != 7 && i - 7 == sq)
-                        return true;
-                }
-                else {
-                    if (COL(i) != 0 && i + 7 == sq)
-                        return true;
-                    if (COL(i) != 7 && i + 9 == sq)
-                        return true;
-                }
-            }
-            else if(board.piece[i] != EMPTY) {
-                int bp = board.piece[i];
-                for (j = 0; j < offsets[bp]; ++j) {
-                    for (n = i;;) {
-                        n = mailbox[mailbox64[n] + offset[bp][j]];
-                        if (n == -1)
-                            break;
-                        if (n == sq)
-                            return true;
-                        if (board.color[n] != EMPTY)
-                            break;
-                        if (!slide[bp])
-                            break;
-                    }
-                }
-            }
-        }
+    const bitboard_t them = board.bb_color[s];
+    const bitboard_t occ = board.bb_color[LIGHT] | board.bb_color[DARK];
+    if (pawn_attacks[s ^ 1][sq] & board.bb_piece[PAWN] & them)
+        return true;
+    if (knight_attacks[sq] & board.bb_piece[KNIGHT] & them)
+        return true;
+    if (king_attacks[sq] & board.bb_piece[KING] & them)
+        return true;
+    if (bishop_attacks(sq, occ) & (board.bb_piece[BISHOP] | board.bb_piece[QUEEN]) & them)
+        return true;
+    if (rook_attacks(sq, occ) & (board.bb_piece[ROOK] | board.bb_piece[QUEEN]) & them)
+        return true;
     return false;
 }
 
+/* attackers_to() returns the pieces of both sides that attack sq
+   when the squares in occ are occupied. */
+
+static bitboard_t attackers_to(const node_t& board, int sq, bitboard_t occ)
+{
+    return (pawn_attacks[DARK][sq] & board.bb_piece[PAWN] & board.bb_color[LIGHT])
+        | (pawn_attacks[LIGHT][sq] & board.bb_piece[PAWN] & board.bb_color[DARK])
+        | (knight_attacks[sq] & board.bb_piece[KNIGHT])
+        | (king_attacks[sq] & board.bb_piece[KING])
+        | (bishop_attacks(sq, occ) & (board.bb_piece[BISHOP] | board.bb_piece[QUEEN]))
+        | (rook_attacks(sq, occ) & (board.bb_piece[ROOK] | board.bb_piece[QUEEN]));
+}
+
+// The piece values of eval.cpp, with a king that nobody can afford to lose
+static const int see_value[6] = {
+    100, 300, 300, 500, 900, 20000
+};
+
+/* see() is the static exchange evaluation of a capture: what the
+   side to move wins (or, if negative, loses) in material if both
+   sides keep recapturing on the to square with their least valuable
+   piece for as long as it pays. Sliders that a capture uncovers
+   behind the piece that made it join in. Pins and checks are
+   ignored. */
+
+int see(const node_t& board, chess_move& m)
+{
+    const int to = m.getTo();
+    int gain[33];
+    int d = 0;
+    int side = board.side;
+    int piece = board.piece[m.getFrom()];
+    bitboard_t from_bb = square_bb(m.getFrom());
+    bitboard_t occ = board.bb_color[LIGHT] | board.bb_color[DARK];
+    const bitboard_t diagonal = board.bb_piece[BISHOP] | board.bb_piece[QUEEN];
+    const bitboard_t straight = board.bb_piece[ROOK] | board.bb_piece[QUEEN];
+
+    if (m.getBits() & 4) {
+        gain[0] = see_value[PAWN];
+        occ ^= square_bb(side == LIGHT ? to + 8 : to - 8);
+    } else if (m.getCapture()) {
+        gain[0] = see_value[(int)board.piece[to]];
+    } else {
+        gain[0] = 0;  // a promotion
+    }
+    if (m.getBits() & 32) {
+        gain[0] += see_value[m.getPromote()] - see_value[PAWN];
+        piece = m.getPromote();
+    }
+    bitboard_t attackers = attackers_to(board, to, occ);
+    for (;;) {
+        d++;
+        // what we have if they take the piece that just captured
+        gain[d] = see_value[piece] - gain[d-1];
+        if (std::max(-gain[d-1], gain[d]) < 0)
+            break;  // whoever is on the move would rather stop
+        attackers &= ~from_bb;
+        occ &= ~from_bb;
+        attackers |= ((bishop_attacks(to, occ) & diagonal)
+            | (rook_attacks(to, occ) & straight)) & occ;
+        side ^= 1;
+        bitboard_t ours = attackers & board.bb_color[side];
+        if (!ours)
+            break;
+        for (piece = PAWN; !(ours & board.bb_piece[piece]); piece++)
+            ;
+        bitboard_t b = ours & board.bb_piece[piece];
+        from_bb = b & (0 - b);
+    }
+    while (--d)
+        gain[d-1] = -std::max(-gain[d-1], gain[d]);
+    return gain[0];
+}
+
 bool workq_sort(const chess_move& m1,const chess_move& m2) {
     return m1.score > m2.score;
 }
 
-/* gen() generates pseudo-legal moves for the current position.
-   It scans the board to find friendly pieces and then determines
-   what squares they attack. When it finds a piece/square
+/* gen_moves() generates pseudo-legal moves for the current position:
+   the captures and promotions if caps is set and the other moves if
+   quiets is set.
+   It goes through the friendly pieces in the bitboards and looks
+   up what squares they attack. When it finds a piece/square
    combination, it calls gen_push to put the chess_move on the "chess_move
    stack." */
 
-void gen(std::vector<chess_move>& workq, const node_t& board)
+static void gen_moves(move_list& workq, const node_t& board, bool caps, bool quiets)
 {
-  int i, j, n;
   do_data();
 
-  // so far, we have no moves for the current ply
-
-  for (i = 0; i < 64; ++i)
-      if (board.color[i] == board.side) {
-          if (board.piece[i] == PAWN) {
+  const bitboard_t us = board.bb_color[board.side];
+  const bitboard_t them = board.bb_color[board.side ^ 1];
+  const bitboard_t occ = us | them;
+  const bitboard_t allowed = (caps ? them : 0) | (quiets ? ~occ : 0);
+
+  for (bitboard_t pieces = us; pieces; ) {
+      int i = pop_lsb(pieces);
+      bitboard_t targets;
+      switch (board.piece[i]) {
+          case PAWN:
+              if (caps)
+                  for (targets = pawn_attacks[board.side][i] & them; targets; )
+                      gen_push(workq, board, i, pop_lsb(targets), 17);
+              // a push to the last row promotes, which counts as a capture
               if (board.side == LIGHT) {
-                  if (COL(i) != 0 && board.color[i - 9] == DARK)
-                      gen_push(workq, board, i, i - 9, 17);
-                  if (COL(i) != 7 && board.color[i - 7] == DARK)
-                      gen_push(workq, board, i, i - 7, 17);
-                  if (board.color[i - 8] == EMPTY) {
-                      gen_push(workq, board, i, i - 8, 16);
-                      if (i >= 48 && board.color[i - 16] == EMPTY)
+                  if (!(occ & square_bb(i - 8))) {
+                      if (i - 8 <= H8_CHESS ? caps : quiets)
+                          gen_push(workq, board, i, i - 8, 16);
+                      if (quiets && i >= 48 && !(occ & square_bb(i - 16)))
                           gen_push(workq, board, i, i - 16, 24);
                   }
               }
               else {
-                  if (COL(i) != 0 && board.color[i + 7] == LIGHT)
-                      gen_push(workq, board, i, i + 7, 17);
-                  if (COL(i) != 7 && board.color[i + 9] == LIGHT)
-                      gen_push(workq, board, i, i + 9, 17);
-                  if (board.color[i + 8] == EMPTY) {
-                      gen_push(workq, board, i, i + 8, 16);
-                      if (i <= 15 && board.color[i + 16] == EMPTY)
+                  if (!(occ & square_bb(i + 8))) {
+                      if (i + 8 >= A1_CHESS ? caps : quiets)
+                          gen_push(workq, board, i, i + 8, 16);
+                      if (quiets && i <= 15 && !(occ & square_bb(i + 16)))
                           gen_push(workq, board, i, i + 16, 24);
                   }
               }
-          }
-          else if(board.piece[i] != EMPTY)
-              for (j = 0; j < offsets[(size_t)board.piece[i]]; ++j)
-                  for (n = i;;) {
-                      n = mailbox[mailbox64[n] + offset[(size_t)board.piece[i]][j]];
-                      if (n == -1)
-                          break;
-                      if (board.color[n] != EMPTY) {
-                          if (board.color[n] == (board.side ^ 1))
-                              gen_push(workq, board, i, n, 1);
-                          break;
-                      }
-                      gen_push(workq, board, i, n, 0);
-                      if (!slide[(size_t)board.piece[i]])
-                          break;
-                  }
+              continue;
+          case KNIGHT:
+              targets = knight_attacks[i];
+              break;
+          case BISHOP:
+              targets = bishop_attacks(i, occ);
+              break;
+          case ROOK:
+              targets = rook_attacks(i, occ);
+              break;
+          case QUEEN:
+              targets = bishop_attacks(i, occ) | rook_attacks(i, occ);
+              break;
+          default:
+              targets = king_attacks[i];
+              break;
+      }
+      targets &= allowed;
+      while (targets) {
+          int n = pop_lsb(targets);
+          gen_push(workq, board, i, n, (them & square_bb(n)) ? 1 : 0);
       }
+  }
 
 
   // generate castle moves
-  if (board.side == LIGHT) {
-      if (board.castle & 1)
-          gen_push(workq, board, E1_CHESS, G1_CHESS, 2);
-      if (board.castle & 2)
-          gen_push(workq, board, E1_CHESS, C1_CHESS, 2);
-  }
-  else {
-      if (board.castle & 4)
-          gen_push(workq, board, E8_CHESS, G8_CHESS, 2);
-      if (board.castle & 8)
-          gen_push(workq, board, E8_CHESS, C8_CHESS, 2);
+  if (quiets) {
+      if (board.side == LIGHT) {
+          if (board.castle & 1)
+              gen_push(workq, board, E1_CHESS, G1_CHESS, 2);
+          if (board.castle & 2)
+              gen_push(workq, board, E1_CHESS, C1_CHESS, 2);
+      }
+      else {
+          if (board.castle & 4)
+              gen_push(workq, board, E8_CHESS, G8_CHESS, 2);
+          if (board.castle & 8)
+              gen_push(workq, board, E8_CHESS, C8_CHESS, 2);
+      }
   }
   
   // generate en passant moves
-  if (board.ep != -1) {
+  if (caps && board.ep != -1) {
       if (board.side == LIGHT) {
           if (COL(board.ep) != 0 && board.color[board.ep + 7] == LIGHT && board.piece[board.ep + 7] == PAWN)
               gen_push(workq, board, board.ep + 7, board.ep, 21);
@@ -281,9 +465,114 @@ void gen(std::vector<chess_move>& workq, const node_t& board)
               gen_push(workq, board, board.ep - 7, board.ep, 21);
       }
   }
+}
+
+/* gen() generates all the pseudo-legal moves, best first */
+
+void gen(move_list& workq, const node_t& board)
+{
+  gen_moves(workq, board, true, true);
   std::sort(workq.begin(),workq.end(),workq_sort);
 }
 
+/* gen_caps() generates only the captures and promotions, for the
+   quiescence search, and gen_quiets() only the rest, neither of them
+   sorted. Together they make up gen(). */
+
+void gen_caps(move_list& workq, const node_t& board)
+{
+  gen_moves(workq, board, true, false);
+}
+
+void gen_quiets(move_list& workq, const node_t& board)
+{
+  gen_moves(workq, board, false, true);
+}
+
+/* decode_move() turns a chess_move in the 16 bit form of
+   get16BitMove() back into a chess_move, exactly as gen() would
+   generate it. It returns false if gen() wouldn't generate it in
+   this position, so moves from the transposition table or from
+   other positions can be tried without generating anything. */
+
+bool decode_move(const node_t& board, uint16_t mv, chess_move& m)
+{
+  const int from = mv & 63;
+  const int to = (mv >> 6) & 63;
+  const int promote = (mv >> 12) & 7;
+  const int side = board.side;
+  const bitboard_t us = board.bb_color[side];
+  const bitboard_t them = board.bb_color[side ^ 1];
+  const bitboard_t occ = us | them;
+
+  if (!(us & square_bb(from)) || (us & square_bb(to)))
+      return false;
+  int bits = (them & square_bb(to)) ? 1 : 0;
+  bitboard_t targets;
+  switch (board.piece[from]) {
+      case PAWN: {
+          const int fwd = (side == LIGHT) ? -8 : 8;
+          if (pawn_attacks[side][from] & square_bb(to)) {
+              if (bits)
+                  bits = 17;
+              else if (to == board.ep)
+                  bits = 21;
+              else
+                  return false;
+          } else if (occ & square_bb(to)) {
+              return false;
+          } else if (to == from + fwd) {
+              bits = 16;
+          } else if (to == from + 2*fwd && !(occ & square_bb(from + fwd))
+                  && (side == LIGHT ? from >= 48 : from <= 15)) {
+              bits = 24;
+          } else {
+              return false;
+          }
+          bool last_row = (side == LIGHT) ? to <= H8_CHESS : to >= A1_CHESS;
+          if (last_row) {
+              if (promote < KNIGHT || promote > QUEEN)
+                  return false;
+              bits |= 32;
+          } else if (promote != 0) {
+              return false;
+          }
+          m.setBytes(from, to, promote, bits);
+          return true;
+      }
+      case KNIGHT:
+          targets = knight_attacks[from];
+          break;
+      case BISHOP:
+          targets = bishop_attacks(from, occ);
+          break;
+      case ROOK:
+          targets = rook_attacks(from, occ);
+          break;
+      case QUEEN:
+          targets = bishop_attacks(from, occ) | rook_attacks(from, occ);
+          break;
+      default:
+          targets = king_attacks[from];
+          if (side == LIGHT && from == E1_CHESS) {
+              if ((to == G1_CHESS && (board.castle & 1))
+                      || (to == C1_CHESS && (board.castle & 2)))
+                  bits = 2;
+          } else if (side == DARK && from == E8_CHESS) {
+              if ((to == G8_CHESS && (board.castle & 4))
+                      || (to == C8_CHESS && (board.castle & 8)))
+                  bits = 2;
+          }
+          if (bits == 2)
+              targets |= square_bb(to);
+          break;
+  }
+  if (promote != 0 || !(targets & square_bb(to)))
+      return false;
+  m.setBytes(from, to, 0, bits);
+  return true;
+}
+
 uint8_t score_piece(uint8_t p) {
     switch(p) {
         case QUEEN:
@@ -311,18 +600,21 @@ uint8_t score_piece(uint8_t p) {
    It also assigns a score to the chess_move for alpha-beta chess_move
    ordering. If the chess_move is a capture, it uses MVV/LVA
    (Most Valuable Victim/Least Valuable Attacker). Otherwise,
-   it uses the chess_move's history heuristic value. Note that
-   1,000,000 is added to a capture chess_move's score, so it
+   it uses the piece that moves; alpha-beta replaces that with
+   the chess_move's history heuristic value (see move_picker). Note
+   that 1,000,000 is added to a capture chess_move's score, so it
    always gets ordered above a "normal" chess_move. */
 
-void gen_push(std::vector<chess_move>& workq, const node_t& board, int from, int to, int bits)
+void gen_push(move_list& workq, const node_t& board, int from, int to, int bits)
 {
     chess_move g;
-    uint8_t score;
+    int32_t score;
 
     // test for capture
     if (bits & 1) {
-        score = 100*score_piece(board.piece[to])
+        // en passant takes a pawn from an empty square
+        int victim = (bits & 4) ? PAWN : board.piece[to];
+        score = 1000000 + 100*score_piece(victim)
                   -10*score_piece(board.piece[from]);
     } else {
         score = score_piece(board.piece[from]);
@@ -352,12 +644,14 @@ void gen_push(std::vector<chess_move>& workq, const node_t& board, int from, int
 /* gen_promote() is just like gen_push(), only it puts 4 moves
    on the chess_move stack, one for each possible promotion piece */
 
-void gen_promote(std::vector<chess_move>& workq, int from, int to, int bits)
+void gen_promote(move_list& workq, int from, int to, int bits)
 {
     int i;
     chess_move g;
     
     for (i = KNIGHT; i <= QUEEN; ++i) {
+        // ordered with the captures, as if taking the new piece
+        g.score = 1000000 + 100*score_piece(i);
         g.setBytes(from, to, i, (bits | 32));
         workq.push_back(g);
     }
@@ -370,15 +664,22 @@ void gen_promote(std::vector<chess_move>& workq, int from, int to, int bits)
 
 bool makemove(node_t& board,chess_move& m)
 {
-    bool needs_set_hash = false;
-    if(board.ep != -1)
-        board.hash ^= hash_ep[board.ep];
-    board.hash = update_hash(board, m);
+    undo_t u;
+    return makemove(board, m, u);
+}
+
+/* This version also fills in u, so that unmakemove() can take
+   the chess_move back. The search uses it to walk the tree on one
+   board instead of copying the board for every child. */
+
+bool makemove(node_t& board,chess_move& m,undo_t& u)
+{
+    u.hash = board.hash;
+
     /* test to see if a castle chess_move is legal and chess_move the rook
        (the king is moved with the usual chess_move code later) */
     if (m.getBits() & 2) {
         int from, to;
-        needs_set_hash = true;
         // It's not legal to castle if
         // the king is not on the from
         // square. SRB
@@ -425,26 +726,36 @@ bool makemove(node_t& board,chess_move& m)
         board.piece[to] = board.piece[from];
         board.color[from] = EMPTY;
         board.piece[from] = EMPTY;
+        toggle(board, board.side, ROOK, from);
+        toggle(board, board.side, ROOK, to);
     }
 
-    board.hist_dat.push_back(board.hash);
+    u.m = m;
+    u.castle = board.castle;
+    u.ep = board.ep;
+    u.fifty = board.fifty;
+    u.captured = board.piece[m.getTo()];
+    u.hist_full = (board.hist_dat.size() == 50);
+    u.hist_lost = u.hist_full ? board.hist_dat[0] : 0;
+
     board.ply++;
     board.hply++;
 
     /* update the castle, en passant, and
        fifty-chess_move-draw variables */
-    board.castle &= castle_mask[m.getFrom()] & castle_mask[m.getTo()];
+    int castle = board.castle & castle_mask[m.getFrom()] & castle_mask[m.getTo()];
+    for (int i = 0; i < 4; ++i)
+        if ((castle ^ board.castle) & (1 << i))
+            board.hash ^= hash_castle[i];
+    board.castle = castle;
+    if (board.ep != -1)
+        board.hash ^= hash_ep[board.ep];
     if (m.getBits() & 8) {
         if (board.side == LIGHT)
-        {
             board.ep = m.getTo() + 8;
-            board.hash ^= hash_ep[board.ep];
-        }
         else
-        {
             board.ep = m.getTo() - 8;
-            board.hash ^= hash_ep[board.ep];
-        }
+        board.hash ^= hash_ep[board.ep];
     }
     else
         board.ep = -1;
@@ -453,29 +764,32 @@ bool makemove(node_t& board,chess_move& m)
     else
         board.fifty++;
 
-    /* move the piece */
+    /* move the piece; toggle() keeps the hash up to date */
+    if (board.color[m.getTo()] != EMPTY)
+        toggle(board, board.color[m.getTo()], board.piece[m.getTo()], m.getTo());
+    toggle(board, board.side, board.piece[m.getFrom()], m.getFrom());
+    if (board.piece[m.getFrom()] == KING)
+        board.king_sq[board.side] = m.getTo();
     board.color[m.getTo()] = board.side;
     if (m.getBits() & 32)
-    {
         board.piece[m.getTo()] = m.getPromote();
-        needs_set_hash = true;
-    }
     else
         board.piece[m.getTo()] = board.piece[m.getFrom()];
     board.color[m.getFrom()] = EMPTY;
     board.piece[m.getFrom()] = EMPTY;
+    toggle(board, board.side, board.piece[m.getTo()], m.getTo());
 
     /* erase the pawn if this is an en passant chess_move */
     if (m.getBits() & 4) {
         if (board.side == LIGHT) {
             board.color[m.getTo() + 8] = EMPTY;
             board.piece[m.getTo() + 8] = EMPTY;
-            needs_set_hash = true;
+            toggle(board, DARK, PAWN, m.getTo() + 8);
         }
         else {
             board.color[m.getTo() - 8] = EMPTY;
             board.piece[m.getTo() - 8] = EMPTY;
-            needs_set_hash = true;
+            toggle(board, LIGHT, PAWN, m.getTo() - 8);
         }
     }
 
@@ -483,31 +797,130 @@ bool makemove(node_t& board,chess_move& m)
        the other guy's king, it's an illegal position and
        we need to return FALSE) */
     board.side ^= 1;
-    
+    board.hash ^= hash_side;
+    board.hist_dat.push_back(board.hash);
+
     if (in_check(board, board.side ^ 1)) {
+        unmakemove(board, u);
         return false;
     }
-    if (needs_set_hash)
-    {
-      board.hash = set_hash(board);
+// This checks that the incremental updates are
+// consistent with set_hash()
 #if CHECK_HASH
-      count2++;
-#endif
-    }
-// This could debugs update_hash(), making sure it's consistent
-// with set_hash()
-#if CHECK_HASH
-    hash_t sh = set_hash(board);
-    if (board.hash == sh)
-      count++;
-    if (board.hash != sh) {
-      std::cerr << "board.hash == " << board.hash << " :: set_hash == " << sh << std::endl;
-      std::cerr << "Number of times board.hash == sh: " << count << std::endl;
-      std::cerr << "Number of times set_hash was called: " << count2 << std::endl;
+    if (board.hash != set_hash(board)) {
+      std::cerr << "board.hash == " << board.hash << " :: set_hash == " << set_hash(board) << std::endl;
       abort();
     }
 #endif
-    //board.hash = set_hash(board);
     assert(board.hash != 0);
     return true;
 }
+
+
+/* unmakemove() takes back the chess_move makemove() made with u,
+   leaving the board exactly as it was before. */
+
+void unmakemove(node_t& board, const undo_t& u)
+{
+    chess_move m = u.m;
+    const int from = m.getFrom();
+    const int to = m.getTo();
+
+    board.side ^= 1;
+    const int moved = (m.getBits() & 32) ? PAWN : board.piece[to];
+
+    /* put the piece back, and whatever it captured */
+    toggle(board, board.side, board.piece[to], to);
+    toggle(board, board.side, moved, from);
+    board.color[from] = board.side;
+    board.piece[from] = moved;
+    if (moved == KING)
+        board.king_sq[board.side] = from;
+    if (u.captured != EMPTY) {
+        board.color[to] = board.side ^ 1;
+        board.piece[to] = u.captured;
+        toggle(board, board.side ^ 1, u.captured, to);
+    }
+    else {
+        board.color[to] = EMPTY;
+        board.piece[to] = EMPTY;
+    }
+
+    /* bring back the pawn taken en passant */
+    if (m.getBits() & 4) {
+        int sq = (board.side == LIGHT) ? to + 8 : to - 8;
+        board.color[sq] = board.side ^ 1;
+        board.piece[sq] = PAWN;
+        toggle(board, board.side ^ 1, PAWN, sq);
+    }
+
+    /* and the rook of a castle chess_move */
+    if (m.getBits() & 2) {
+        int rook_from, rook_to;
+        switch (to) {
+            case 62: rook_from = H1_CHESS; rook_to = F1_CHESS; break;
+            case 58: rook_from = A1_CHESS; rook_to = D1_CHESS; break;
+            case 6:  rook_from = H8_CHESS; rook_to = F8_CHESS; break;
+            default: rook_from = A8_CHESS; rook_to = D8_CHESS; break;
+        }
+        board.color[rook_from] = board.side;
+        board.piece[rook_from] = ROOK;
+        board.color[rook_to] = EMPTY;
+        board.piece[rook_to] = EMPTY;
+        toggle(board, board.side, ROOK, rook_from);
+        toggle(board, board.side, ROOK, rook_to);
+    }
+
+    board.hist_dat.pop_back();
+    if (u.hist_full)
+        board.hist_dat.push_front(u.hist_lost);
+    board.castle = u.castle;
+    board.ep = u.ep;
+    board.fifty = u.fifty;
+    board.hash = u.hash;
+    board.ply--;
+    board.hply--;
+}
+
+
+/* make_null() passes the turn to the other side without moving,
+   for null move pruning. The fifty chess_move count starts over, so
+   that reps() doesn't find repetitions across the null move, and the
+   position is not added to hist_dat. unmake_null() takes it back. */
+
+void make_null(node_t& board, undo_t& u)
+{
+    u.hash = board.hash;
+    u.ep = board.ep;
+    u.fifty = board.fifty;
+    if (board.ep != -1)
+        board.hash ^= hash_ep[board.ep];
+    board.ep = -1;
+    board.fifty = 0;
+    board.side ^= 1;
+    board.hash ^= hash_side;
+    board.ply++;
+    board.hply++;
+}
+
+void unmake_null(node_t& board, const undo_t& u)
+{
+    board.side ^= 1;
+    board.ep = u.ep;
+    board.fifty = u.fifty;
+    board.hash = u.hash;
+    board.ply--;
+    board.hply--;
+}
+
+
+/* takeback() takes back the last chess_move of the game, which
+   is kept in history along with the other moves played. */
+
+void takeback(node_t& board, std::vector<undo_t>& history)
+{
+    if (history.empty())
+        return;
+    unmakemove(board, history.back());
+    history.pop_back();
+}
@@ -9,6 +9,7 @@
  */
 
 #include "eval.hpp"
+#include <boost/atomic.hpp>
 
 // the values of the pieces
 const int piece_value[6] = {
@@ -17,7 +18,9 @@ const int piece_value[6] = {
 
 /* The "pcsq" arrays are piece/square tables. They're values
    added to the material value of the piece based on the
-   location of the piece. */
+   location of the piece. Those of the pawns, knights and
+   bishops are summed up in the board by makemove() (see
+   pcsq_value()). */
 
 const int pawn_pcsq[64] = {
       0,   0,   0,   0,   0,   0,   0,   0,
@@ -101,12 +104,134 @@ int piece_mat[2];  // the value of a side's pieces
 int pawn_mat[2];  // the value of a side's pawns
 */
 
+/* The pawn structure changes much more rarely than the rest of the
+   position, so each thread keeps what it found for the positions of
+   the pawns it saw last, indexed by base_node_t::pawn_hash. An empty
+   entry holds what a board without pawns evaluates to, which is also
+   what it hashes to, so no key is ever wrong for an entry that was
+   never filled. */
+
+const int PAWN_TABLE_SIZE = 1 << 13;  // a power of two
+
+struct pawn_entry {
+    hash_t key;
+    int score;  // LIGHT's pawn structure terms minus DARK's
+    int8_t pawn_rank[2][10];
+
+    pawn_entry() : key(0), score(0) {
+        for (int f = 0; f < 10; ++f) {
+            pawn_rank[LIGHT][f] = 0;
+            pawn_rank[DARK][f] = 7;
+        }
+    }
+};
+
+static thread_local pawn_entry pawn_table[PAWN_TABLE_SIZE];
+
+/* eval_pawns() sets up pawn_rank and returns LIGHT's pawn structure
+   score minus DARK's, from the pawn table if it can */
+
+int evaluator::eval_pawns(const node_t& board)
+{
+    int i;
+    int f;  // file
+    int score;
+    bitboard_t b;
+
+    pawn_entry& e = pawn_table[board.pawn_hash & (PAWN_TABLE_SIZE - 1)];
+    if (e.key == board.pawn_hash) {
+        for (f = 0; f < 10; ++f) {
+            pawn_rank[LIGHT][f] = e.pawn_rank[LIGHT][f];
+            pawn_rank[DARK][f] = e.pawn_rank[DARK][f];
+        }
+        return e.score;
+    }
+
+    for (i = 0; i < 10; ++i) {
+        pawn_rank[LIGHT][i] = 0;
+        pawn_rank[DARK][i] = 7;
+    }
+    const bitboard_t light_pawns = board.bb_piece[PAWN] & board.bb_color[LIGHT];
+    const bitboard_t dark_pawns = board.bb_piece[PAWN] & board.bb_color[DARK];
+    for (b = light_pawns; b; ) {
+        i = pop_lsb(b);
+        f = COL(i) + 1;  // add 1 because of the extra file in the array
+        if (pawn_rank[LIGHT][f] < ROW(i))
+            pawn_rank[LIGHT][f] = ROW(i);
+    }
+    for (b = dark_pawns; b; ) {
+        i = pop_lsb(b);
+        f = COL(i) + 1;
+        if (pawn_rank[DARK][f] > ROW(i))
+            pawn_rank[DARK][f] = ROW(i);
+    }
+
+    score = 0;
+    for (b = light_pawns; b; )
+        score += eval_light_pawn(pop_lsb(b));
+    for (b = dark_pawns; b; )
+        score -= eval_dark_pawn(pop_lsb(b));
+
+    e.key = board.pawn_hash;
+    e.score = score;
+    for (f = 0; f < 10; ++f) {
+        e.pawn_rank[LIGHT][f] = pawn_rank[LIGHT][f];
+        e.pawn_rank[DARK][f] = pawn_rank[DARK][f];
+    }
+    return score;
+}
+
+/* The same leaf is often evaluated again soon after, through a
+   transposition or an MTD-f re-search, so eval_orig() scores are
+   kept in a table shared by all threads. Like the transposition
+   table it is read and written without locks: each slot xors the key
+   into the word with the score, and a slot torn by a concurrent write
+   just doesn't match. Entries are never worth more than the work of
+   one evaluation, so a new one always replaces the old. An empty slot
+   could only match a hash of 0, which makemove() never lets a board
+   have. */
+
+const int EVAL_CACHE_SIZE = 1 << 16;  // a power of two
+
+struct eval_slot {
+    boost::atomic<uint64_t> check;
+    boost::atomic<uint64_t> score;
+    eval_slot() : check(0), score(0) {
+    }
+};
+
+static eval_slot eval_cache[EVAL_CACHE_SIZE];
+
+thread_local uint64_t eval_cache_hits = 0;
+thread_local uint64_t eval_cache_misses = 0;
+
+void clear_eval_cache()
+{
+    for (int i = 0; i < EVAL_CACHE_SIZE; i++) {
+        eval_cache[i].check.store(0, boost::memory_order_relaxed);
+        eval_cache[i].score.store(0, boost::memory_order_relaxed);
+    }
+}
+
 int evaluator::eval(const node_t& board, int evaluator)
 {
     // Interface function that selects which evaluator to use
     
-    if (evaluator == ORIGINAL)
-        return eval_orig(board);
+    if (evaluator == ORIGINAL) {
+        const uint64_t key = board.hash;
+        eval_slot& e = eval_cache[board.hash & (EVAL_CACHE_SIZE - 1)];
+        uint64_t score = e.score.load(boost::memory_order_relaxed);
+        if ((e.check.load(boost::memory_order_relaxed) ^ score) == key) {
+            eval_cache_hits++;
+            return int32_t(uint32_t(score));
+        }
+        eval_cache_misses++;
+        int s = eval_orig(board);
+        score = uint32_t(s);
+        e.check.store(key ^ score, boost::memory_order_relaxed);
+        e.score.store(score, boost::memory_order_relaxed);
+        return s;
+    }
     else
         return eval_simple(board);
 }
@@ -156,104 +281,57 @@ int evaluator::eval_simple(const node_t& board)
 int evaluator::eval_orig(const node_t& board)
 {
     int i;
-    int f;  // file
     int score[2];  // each side's score
-
-    f = i = 0;
-    score[0] = score[1] = 0;
-
-    // this is the first pass: set up pawn_rank, piece_mat, and pawn_mat.
-    for (i = 0; i < 10; ++i) {
-        pawn_rank[LIGHT][i] = 0;
-        pawn_rank[DARK][i] = 7;
+    bitboard_t b;
+
+    /* the material and the piece/square values of the pawns, knights
+       and bishops are kept up to date by makemove(), so we start from
+       those and only look at the pieces whose value depends on where
+       the pawns are */
+    score[LIGHT] = board.piece_mat[LIGHT] + board.pawn_mat[LIGHT] + board.pcsq[LIGHT];
+    score[DARK] = board.piece_mat[DARK] + board.pawn_mat[DARK] + board.pcsq[DARK];
+    piece_mat[LIGHT] = board.piece_mat[LIGHT];
+    piece_mat[DARK] = board.piece_mat[DARK];
+
+    // the pawn structure, which comes as LIGHT's advantage
+    score[LIGHT] += eval_pawns(board);
+
+    // rooks on open files and on the seventh rank
+    for (b = board.bb_piece[ROOK] & board.bb_color[LIGHT]; b; ) {
+        i = pop_lsb(b);
+        if (pawn_rank[LIGHT][COL(i) + 1] == 0) {
+            if (pawn_rank[DARK][COL(i) + 1] == 7)
+                score[LIGHT] += ROOK_OPEN_FILE_BONUS;
+            else
+                score[LIGHT] += ROOK_SEMI_OPEN_FILE_BONUS;
+        }
+        if (ROW(i) == 1)
+            score[LIGHT] += ROOK_ON_SEVENTH_BONUS;
     }
-    piece_mat[LIGHT] = 0;
-    piece_mat[DARK] = 0;
-    pawn_mat[LIGHT] = 0;
-    pawn_mat[DARK] = 0;
-    for (i = 0; i < 64; ++i) {
-        if (board.color[i] == EMPTY)
-            continue;
-        if (board.piece[i] == PAWN) {
-            pawn_mat[(int)board.color[i]] += piece_value[PAWN];
-            f = COL(i) + 1;  // add 1 because of the extra file in the array
-            if (board.color[i] == LIGHT) {
-                if (pawn_rank[LIGHT][f] < ROW(i))
-                    pawn_rank[LIGHT][f] = ROW(i);
-            }
-            else {
-                if (pawn_rank[DARK][f] > ROW(i))
-                    pawn_rank[DARK][f] = ROW(i);
-            }
+    for (b = board.bb_piece[ROOK] & board.bb_color[DARK]; b; ) {
+        i = pop_lsb(b);
+        if (pawn_rank[DARK][COL(i) + 1] == 7) {
+            if (pawn_rank[LIGHT][COL(i) + 1] == 0)
+                score[DARK] += ROOK_OPEN_FILE_BONUS;
+            else
+                score[DARK] += ROOK_SEMI_OPEN_FILE_BONUS;
         }
-        else
-            piece_mat[(int)board.color[i]] += piece_value[(int)board.piece[i]];
+        if (ROW(i) == 6)
+            score[DARK] += ROOK_ON_SEVENTH_BONUS;
     }
 
-    // this is the second pass: evaluate each piece
-    score[LIGHT] = piece_mat[LIGHT] + pawn_mat[LIGHT];
-    score[DARK] = piece_mat[DARK] + pawn_mat[DARK];
-    for (i = 0; i < 64; ++i) {
-        if (board.color[i] == EMPTY)
-            continue;
-        if (board.color[i] == LIGHT) {
-            switch (board.piece[i]) {
-                case PAWN:
-                    score[LIGHT] += eval_light_pawn(i);
-                    break;
-                case KNIGHT:
-                    score[LIGHT] += knight_pcsq[i];
-                    break;
-                case BISHOP:
-                    score[LIGHT] += bishop_pcsq[i];
-                    break;
-                case ROOK:
-                    if (pawn_rank[LIGHT][COL(i) + 1] == 0) {
-                        if (pawn_rank[DARK][COL(i) + 1] == 7)
-                            score[LIGHT] += ROOK_OPEN_FILE_BONUS;
-                        else
-                            score[LIGHT] += ROOK_SEMI_OPEN_FILE_BONUS;
-                    }
-                    if (ROW(i) == 1)
-                        score[LIGHT] += ROOK_ON_SEVENTH_BONUS;
-                    break;
-                case KING:
-                    if (piece_mat[DARK] <= 1200)
-                        score[LIGHT] += king_endgame_pcsq[i];
-                    else
-                        score[LIGHT] += eval_light_king(i);
-                    break;
-            }
-        }
-        else {
-            switch (board.piece[i]) {
-                case PAWN:
-                    score[DARK] += eval_dark_pawn(i);
-                    break;
-                case KNIGHT:
-                    score[DARK] += knight_pcsq[flip[i]];
-                    break;
-                case BISHOP:
-                    score[DARK] += bishop_pcsq[flip[i]];
-                    break;
-                case ROOK:
-                    if (pawn_rank[DARK][COL(i) + 1] == 7) {
-                        if (pawn_rank[LIGHT][COL(i) + 1] == 0)
-                            score[DARK] += ROOK_OPEN_FILE_BONUS;
-                        else
-                            score[DARK] += ROOK_SEMI_OPEN_FILE_BONUS;
-                    }
-                    if (ROW(i) == 6)
-                        score[DARK] += ROOK_ON_SEVENTH_BONUS;
-                    break;
-                case KING:
-                    if (piece_mat[LIGHT] <= 1200)
-                        score[DARK] += king_endgame_pcsq[flip[i]];
-                    else
-                        score[DARK] += eval_dark_king(i);
-                    break;
-            }
-        }
+    // the kings
+    if ((i = board.king_sq[LIGHT]) != -1) {
+        if (piece_mat[DARK] <= 1200)
+            score[LIGHT] += king_endgame_pcsq[i];
+        else
+            score[LIGHT] += eval_light_king(i);
+    }
+    if ((i = board.king_sq[DARK]) != -1) {
+        if (piece_mat[LIGHT] <= 1200)
+            score[DARK] += king_endgame_pcsq[flip[i]];
+        else
+            score[DARK] += eval_dark_king(i);
     }
 
     /* the score[] array is set, now return the score relative
@@ -271,8 +349,6 @@ int evaluator::eval_light_pawn(int sq)
     r = 0;
     f = COL(sq) + 1;
 
-    r += pawn_pcsq[sq];
-
     // if there's a pawn behind this one, it's doubled
     if (pawn_rank[LIGHT][f] > ROW(sq))
         r -= DOUBLED_PAWN_PENALTY;
@@ -305,8 +381,6 @@ int evaluator::eval_dark_pawn(int sq)
     r = 0;
     f = COL(sq) + 1;
 
-    r += pawn_pcsq[flip[sq]];
-
     // if there's a pawn behind this one, it's doubled
     if (pawn_rank[DARK][f] < ROW(sq))
         r -= DOUBLED_PAWN_PENALTY;
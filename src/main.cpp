@@ -18,6 +18,10 @@
 #include "parallel_support.hpp"
 #include <boost/algorithm/string.hpp>
 #include "main.hpp"
+#include "zkey.hpp"
+#include "perft.hpp"
+#include "pool.hpp"
+#include "eval.hpp"
 #include <signal.h>
 #include <fstream>
 #include <sys/time.h>
@@ -32,6 +36,7 @@
 #endif
 #include <sstream>
 #include <iomanip>
+#include <ctype.h>
 
 using namespace std;
 
@@ -98,13 +103,15 @@ int chx_main()
 
     init_hash();  /* Init hash sets up the hashing function
                      which is used for determining repeated moves */
+    init_bitboards();  // Fills the attack tables used by gen()
     init_board(board);  // Initialize the board to its default state
-    std::vector<chess_move> workq;  /* workq is a standard vector which contains
+    move_list workq;  /* workq is a fixed size list which contains
                                  all possible psuedo-legal moves for the
                                  current board position */
     gen(workq, board);  /* gen() takes the current board position and
                            puts all of the psuedo-legal moves for the
                            position inside of the workq vector. */
+    std::vector<undo_t> history;  // the moves played so far, for "undo"
 
     for (;;) {
         if (board.side == computer_side) {  // computer's turn
@@ -118,10 +125,14 @@ int chx_main()
                 computer_side = EMPTY;
                 continue;
             }
+            if (clock_ms[board.side] >= 0)
+                clock_ms[board.side] = max(clock_ms[board.side] - (end-start), 0) + inc_ms[board.side];
             if (output)
                 std::cout << "Computer's chess_move: " << move_str(move_to_make) << " time=" << std::setprecision(3) << 1e-3*(end-start) << " sec"
                     << std::endl;
-            makemove(board, move_to_make); // Make the chess_move for our master board
+            undo_t u;
+            makemove(board, move_to_make, u); // Make the chess_move for our master board
+            history.push_back(u);
             board.ply = 0; // Reset the board ply to 0
 
             workq.clear(); // Clear the work queue in preparation for next chess_move
@@ -189,9 +200,23 @@ int chx_main()
             continue;
         }
 #endif
+        if (input[0] == "undo") {
+            if (history.empty()) {
+                std::cout << "No moves to take back." << std::endl;
+                continue;
+            }
+            computer_side = EMPTY;
+            takeback(board, history);
+            board.ply = 0;
+            workq.clear();
+            gen(workq, board);
+            continue;
+        }
         if (input[0] == "new") {
             computer_side = EMPTY;
             init_board(board);
+            history.clear();
+            clear_transposition_table();
             workq.clear();
             gen(workq, board);
             continue;
@@ -227,6 +252,39 @@ int chx_main()
           }
           continue;
         }
+        if (input[0] == "time") {
+          if (input.size() < 2) {
+            std::cout << "Clock: " << clock_ms[LIGHT] << " ms white, " << clock_ms[DARK]
+              << " ms black, increment " << inc_ms[LIGHT] << " ms, moves to go "
+              << moves_to_go << std::endl;
+            continue;
+          }
+          if (input[1] == "off") {
+            clock_ms[LIGHT] = clock_ms[DARK] = -1;
+            continue;
+          }
+          clock_ms[LIGHT] = clock_ms[DARK] = max(atoi(input[1].c_str()), 0);
+          inc_ms[LIGHT] = inc_ms[DARK] = (input.size() > 2) ? max(atoi(input[2].c_str()), 0) : 0;
+          moves_to_go = (input.size() > 3) ? max(atoi(input[3].c_str()), 0) : 0;
+          continue;
+        }
+        if (input[0] == "movetime") {
+          try {
+            move_time_ms = max(atoi(input.at(1).c_str()), 0);
+          }
+          catch (out_of_range&) {
+            std::cout << "Time for each chess_move: " << move_time_ms << " ms" << std::endl;
+          }
+          continue;
+        }
+        if (input[0] == "xboard") {
+            xboard();
+            return 0;
+        }
+        if (input[0] == "uci") {
+            uci();
+            return 0;
+        }
         if (input[0] == "d") {
             print_board(board, std::cout);
             continue;
@@ -267,9 +325,152 @@ int chx_main()
 #endif
             }
             task_counter.set_max(atoi(arg.c_str()));
+#ifndef HPX_SUPPORT
+            workers.start(atoi(arg.c_str()));
+#endif
             std::cout << "Set the number of threads to " << arg << std::endl;
             continue; 
         }
+        if (input[0] == "splitdepth") {
+          try {
+            split_depth = atoi(input.at(1).c_str());
+          }
+          catch (out_of_range&) {
+            std::cout << "Shallowest depth to split at: " << split_depth << std::endl;
+          }
+          if (split_depth < 1)
+          {
+              std::cerr << "Illegal depth given, setting depth to 1."
+                  << std::endl;
+              split_depth = 1;
+          }
+          continue;
+        }
+        if (input[0] == "aspiration") {
+          try {
+            aspiration_width = atoi(input.at(1).c_str());
+          }
+          catch (out_of_range&) {
+            std::cout << "Aspiration window width: " << aspiration_width << std::endl;
+          }
+          if (aspiration_width < 0)
+              aspiration_width = 0;
+          continue;
+        }
+        if (input[0] == "mtdf") {
+          if (input.size() < 4) {
+            std::cout << "MTD-f start_width " << mtdf_start_width << ", max_tries "
+              << mtdf_max_tries << ", grow_width " << mtdf_grow_width << std::endl;
+            continue;
+          }
+          mtdf_start_width = atoi(input[1].c_str());
+          mtdf_max_tries = atoi(input[2].c_str());
+          mtdf_grow_width = atoi(input[3].c_str());
+          if (mtdf_start_width < 0 || mtdf_max_tries < 0 || mtdf_grow_width < 1)
+          {
+              std::cerr << "Illegal MTD-f parameters given, using 4 4 4."
+                  << std::endl;
+              mtdf_start_width = mtdf_max_tries = mtdf_grow_width = 4;
+          }
+          continue;
+        }
+        if (input[0] == "nullmove" || input[0] == "lmr") {
+          bool& flag = (input[0] == "nullmove") ? null_move_enabled : lmr_enabled;
+          if (input.size() < 2)
+            std::cout << input[0] << " is " << (flag ? "on" : "off") << std::endl;
+          else if (input[1] == "on")
+            flag = true;
+          else if (input[1] == "off")
+            flag = false;
+          else
+            std::cerr << "Please say on or off." << std::endl;
+          continue;
+        }
+        if (input[0] == "split") {
+          std::string split_m;
+          try {
+            split_m = input.at(1);
+          }
+          catch (out_of_range&) {
+            std::cout << "Name of split method (batch,ybwc): ";
+            std::cin >> split_m;
+          }
+          if (split_m == "batch") {
+              split_method = SPLIT_BATCH;
+          } else if (split_m == "ybwc") {
+              split_method = SPLIT_YBWC;
+          } else {
+            std::cout << "Invalid split method specified." << std::endl;
+          }
+          continue;
+        }
+        if (input[0] == "hash") {
+          std::string arg;
+          try {
+            arg = input.at(1);
+          }
+          catch (out_of_range&) {
+            std::cout << "Hash table size (MB): ";
+            std::cin >> arg;
+          }
+          bool huge_pages = chx_huge_pages();
+          if (input.size() > 2)
+            huge_pages = (input[2] == "huge");
+          int mb = atoi(arg.c_str());
+          if (mb <= 0) {
+            std::cout << "Invalid hash table size." << std::endl;
+          } else if (resize_transposition_table(mb, huge_pages)) {
+            std::cout << "Hash table has " << table_size << " entries ("
+              << (table_size*sizeof(zkey_t)) / (1024*1024) << " MB"
+              << (huge_pages ? ", huge pages" : "") << ")" << std::endl;
+          }
+          continue;
+        }
+        if (input[0] == "setboard") {
+          std::string fen;
+          for (size_t i = 1; i < input.size(); i++)
+            fen += input[i] + " ";
+          node_t newboard;
+          if (!set_fen(newboard, fen)) {
+            std::cout << "Invalid FEN." << std::endl;
+            continue;
+          }
+          board = newboard;
+          history.clear();
+          computer_side = EMPTY;
+          workq.clear();
+          gen(workq, board);
+          continue;
+        }
+        if (input[0] == "perft" || input[0] == "divide") {
+          int perft_depth;
+          try {
+            perft_depth = atoi(input.at(1).c_str());
+          }
+          catch (out_of_range&) {
+            std::cout << "Depth (ply): ";
+            std::cin >> perft_depth;
+          }
+          bool use_hash = (input.size() > 2 && input[2] == "hash");
+          perft_root(board, perft_depth, use_hash, input[0] == "divide");
+          continue;
+        }
+        if (input[0] == "perftsuite") {
+          std::string filename;
+          try {
+            filename = input.at(1);
+          }
+          catch (out_of_range&) {
+            std::cout << "Name of file: ";
+            std::cin >> filename;
+          }
+          int max_depth = 4;
+          if (input.size() > 2)
+            max_depth = atoi(input[2].c_str());
+          bool use_hash = (input.size() > 3 && input[3] == "hash");
+          perft_suite(filename, max_depth, use_hash);
+          continue;
+        }
         if (input[0] == "bench") {
           bench_mode = true;
           int ply_level;
@@ -331,7 +532,7 @@ int chx_main()
             search_m = input.at(1);
           }
           catch (out_of_range&) {
-            std::cout << "Name of search method (minimax,alphabeta,mtdf): ";
+            std::cout << "Name of search method (minimax,alphabeta,mtdf,lazysmp): ";
             std::cin >> search_m;
           }
           if (search_m == "minimax") {
@@ -340,6 +541,8 @@ int chx_main()
               search_method = ALPHABETA;
           } else if (search_m == "mtdf") {
               search_method = MTDF;
+          } else if (search_m == "lazysmp") {
+              search_method = LAZYSMP;
           } else {
             std::cout << "Invalid method specified." << std::endl;
           }
@@ -349,6 +552,21 @@ int chx_main()
           std::cout << std::endl;
           std::cout << "  bench <name of file> <search depth> <number of runs>\n\tstarts the benchmark" << std::endl;
           std::cout << "  parallel <number of threads> \n\tSets the max number of parallel threads (threads=" << task_counter.get() << ")" << std::endl;
+          std::cout << "  splitdepth <number>\n\tsets the shallowest depth searched in parallel (currently " << split_depth << ")" << std::endl;
+          std::cout << "  split <method>\n\tswitches how alpha-beta searches in parallel ("
+            << "batch" << ((split_method == SPLIT_BATCH) ? "=current" : "") << ","
+            << "ybwc" << ((split_method == SPLIT_YBWC) ? "=current" : "") << ")"
+            << std::endl;
+          std::cout << "  aspiration <width>\n\tsets the window alpha-beta searches around the last iteration's score, 0 for none (currently " << aspiration_width << ")" << std::endl;
+          std::cout << "  nullmove on|off\n\tswitches null move pruning in alpha-beta and MTD-f (currently " << (null_move_enabled ? "on" : "off") << ")" << std::endl;
+          std::cout << "  lmr on|off\n\tswitches late move reductions in alpha-beta and MTD-f (currently " << (lmr_enabled ? "on" : "off") << ")" << std::endl;
+          std::cout << "  mtdf <start_width> <max_tries> <grow_width>\n\tsets the MTD-f parameters (currently "
+            << mtdf_start_width << " " << mtdf_max_tries << " " << mtdf_grow_width << ")" << std::endl;
+          std::cout << "  hash <MB> [huge]\n\tresizes the transposition table (entries=" << table_size << ")" << std::endl;
+          std::cout << "  perft <depth> [hash]\n\tcounts the leaf nodes of the chess_move tree from this position" << std::endl;
+          std::cout << "  divide <depth> [hash]\n\tlike perft, with the count under each chess_move" << std::endl;
+          std::cout << "  perftsuite <file> [max depth] [hash]\n\tchecks perft counts for the positions in an EPD file" << std::endl;
+          std::cout << "  setboard <FEN>\n\tsets up the position given in FEN" << std::endl;
           std::cout << "  eval <evaluator>\n\tswitches the current chess_move evaluator in use ("
             << "original" << ((chosen_evaluator == ORIGINAL) ? "=current" : "") << ","
             << "simple" << ((chosen_evaluator == SIMPLE) ? "=current" : "") << ")"
@@ -357,8 +575,13 @@ int chx_main()
           std::cout << "  go\n\tcomputer makes a chess_move" << std::endl;
           std::cout << "  auto\n\tcomputer will continue to make moves until game is over" << std::endl;
           std::cout << "  new\n\tstarts a new game" << std::endl;
+          std::cout << "  undo\n\ttakes back the last chess_move" << std::endl;
           std::cout << "  wd <number>\n\tsets white search depth (currently " << depth[LIGHT] << ")" << std::endl;
           std::cout << "  bd <number>\n\tsets black search depth (currently " << depth[DARK] << ")" << std::endl;
+          std::cout << "  time <ms> [<increment ms> [<moves to go>]]\n\tsets both clocks, which limit the search by time instead of depth; \"time off\" removes them" << std::endl;
+          std::cout << "  movetime <ms>\n\tsearches each chess_move for a fixed time, 0 for none (currently " << move_time_ms << ")" << std::endl;
+          std::cout << "  xboard\n\tspeaks the xboard/WinBoard protocol from here on" << std::endl;
+          std::cout << "  uci\n\tspeaks the Universal Chess Interface from here on" << std::endl;
           std::cout << "  d\n\tdisplay the board" << std::endl;
           std::cout << "  o <on/off>\n\ttoggles engine output on or off (default on)" << std::endl;
           std::cout << "  exit\n\texit the program" << std::endl;
@@ -375,7 +598,9 @@ int chx_main()
         if (m == -1 || !makemove(newboard, mov))
             std::cout << "Illegal chess_move or command." << std::endl;
         else {
-            makemove(board, mov);
+            undo_t u;
+            makemove(board, mov, u);
+            history.push_back(u);
             board.ply = 0;
             workq.clear();
             gen(workq, board);
@@ -397,17 +622,37 @@ int chx_threads_per_proc() {
     return thcount;
 }
 
+int chx_hash_mb() {
+    const char *mb = getenv("CHX_HASH_MB");
+    int hash_mb = 16;
+    if(mb != NULL && atoi(mb) > 0)
+        hash_mb = atoi(mb);
+    return hash_mb;
+}
+
+bool chx_huge_pages() {
+    const char *hp = getenv("CHX_HUGE_PAGES");
+    return hp != NULL && atoi(hp) != 0;
+}
+
 int main(int argc, char *argv[])
 {
     int threads_per_proc = chx_threads_per_proc();
-    task_counter.add(threads_per_proc);
+    task_counter.set_max(threads_per_proc);
+#ifndef HPX_SUPPORT
+    workers.start(threads_per_proc);
+#endif
+    if(!resize_transposition_table(chx_hash_mb(), chx_huge_pages()))
+        return 1;
     chx_terminate();
 #ifdef HPX_SUPPORT
     boost::program_options::options_description
         desc_commandline("usage: " HPX_APPLICATION_STRING " [options]");
     return hpx::init(desc_commandline, argc, argv);
 #else
-    return chx_main();
+    int ret = chx_main();
+    workers.stop();
+    return ret;
 #endif
 }
 
@@ -465,6 +710,16 @@ void start_benchmark(std::string filename, int ply_level, int num_runs,bool para
   } else if (search_method == MTDF) {
     std::cout << "  search method: MTD-f" << std::endl;
     logfile << "  search method: MTD-f" << std::endl;
+  } else if (search_method == LAZYSMP) {
+    std::cout << "  search method: lazy SMP" << std::endl;
+    logfile << "  search method: lazy SMP" << std::endl;
+  }
+  if (split_method == SPLIT_BATCH) {
+    std::cout << "  parallel split: batch" << std::endl;
+    logfile << "  parallel split: batch" << std::endl;
+  } else if (split_method == SPLIT_YBWC) {
+    std::cout << "  parallel split: ybwc" << std::endl;
+    logfile << "  parallel split: ybwc" << std::endl;
   }
 
   // reading board configuration
@@ -558,16 +813,17 @@ void start_benchmark(std::string filename, int ply_level, int num_runs,bool para
   benchfile.close();
 
   board.side = LIGHT;
-  board.castle = 15;
   board.ep = -1;
   board.fifty = 0;
   board.ply = 0;
   board.hply = 0;
+  set_bitboards(board);
+  board.castle = castle_rights(board);
   board.hash = set_hash(board);
   //At this point we have the board position configured to the file specification
   print_board(board, std::cout);
   print_board(board, logfile);
-  std::vector<chess_move> workq;
+  move_list workq;
   gen(workq, board);
 
   int start_time;
@@ -582,15 +838,30 @@ void start_benchmark(std::string filename, int ply_level, int num_runs,bool para
     std::cout << "Run " << i+1 << " ";
     logfile << "Run " << i+1 << " ";
     fflush(stdout);
+    clear_transposition_table();    // Keep the runs independent
+    clear_eval_cache();
+    uint64_t start_nodes = nodes_searched;
+    uint64_t start_allocs = heap_allocs;
+    uint64_t start_hits = eval_cache_hits;
+    uint64_t start_misses = eval_cache_misses;
     start_time = get_ms();          // Start the clock
     think(board,parallel);          // Do the processing
     t[i] = get_ms() - start_time;   // Measure the time
+    // Only this thread's share; helpers count their own
+    uint64_t nodes = nodes_searched - start_nodes;
+    uint64_t allocs = heap_allocs - start_allocs;
     if (i == 0)
       best_time = t[0];
     else if (t[i] < best_time)
       best_time = t[i];
     std::cout << "time: " << t[i] << " ms" << std::endl;
     logfile << "time: " << t[i] << " ms" << std::endl;
+    std::cout << "  nodes: " << nodes << ", heap allocations: " << allocs << std::endl;
+    logfile << "  nodes: " << nodes << ", heap allocations: " << allocs << std::endl;
+    uint64_t hits = eval_cache_hits - start_hits;
+    uint64_t misses = eval_cache_misses - start_misses;
+    std::cout << "  eval cache: " << hits << " hits, " << misses << " misses" << std::endl;
+    logfile << "  eval cache: " << hits << " hits, " << misses << " misses" << std::endl;
 
     if (move_to_make.get32BitMove() == 0) {
       std::cout << "(no legal moves)" << std::endl;
@@ -603,6 +874,16 @@ void start_benchmark(std::string filename, int ply_level, int num_runs,bool para
 
       logfile << "  Computer's chess_move: " << move_str(move_to_make)
         << std::endl;
+      if (pv.length > 0) {
+        std::cout << "  pv:";
+        logfile << "  pv:";
+        for (int j = 0; j < pv.length; j++) {
+          std::cout << " " << move_str(pv.moves[j]);
+          logfile << " " << move_str(pv.moves[j]);
+        }
+        std::cout << std::endl;
+        logfile << std::endl;
+      }
     }
     // Allow time for aborted threads to get cleaned up
     sleep(2);
@@ -635,7 +916,7 @@ void start_benchmark(std::string filename, int ply_level, int num_runs,bool para
 /* parse the chess_move s (in coordinate notation) and return the chess_move's
    int value, or -1 if the chess_move is illegal */
 
-int parse_move(std::vector<chess_move>& workq, const char *s)
+int parse_move(move_list& workq, const char *s)
 {
   int from, to;
 
@@ -651,22 +932,27 @@ int parse_move(std::vector<chess_move>& workq, const char *s)
   to = s[2] - 'a';
   to += 8 * (8 - (s[3] - '0'));
 
+  // a promotion is to a queen unless s says otherwise, in either case
+  int promote;
+  switch (toupper(s[4])) {
+    case 'N':
+      promote = KNIGHT;
+      break;
+    case 'B':
+      promote = BISHOP;
+      break;
+    case 'R':
+      promote = ROOK;
+      break;
+    default:
+      promote = QUEEN;
+      break;
+  }
+
   for (size_t i = 0; i < workq.size(); i++) {
     if (workq[i].getFrom() == from && workq[i].getTo() == to) {
-      if (workq[i].getBits() & 32)
-        switch (s[4]) {
-          case 'N':
-            if (workq[i].getPromote() == KNIGHT)
-              return workq[i].get32BitMove();
-          case 'B':
-            if (workq[i].getPromote() == BISHOP)
-              return workq[i].get32BitMove();
-          case 'R':
-            if (workq[i].getPromote() == ROOK)
-              return workq[i].get32BitMove();
-          default:
-            return workq[i].get32BitMove();
-        }
+      if ((workq[i].getBits() & 32) && workq[i].getPromote() != promote)
+        continue;
       return workq[i].get32BitMove();
     }
   }
@@ -745,7 +1031,7 @@ void print_board(const node_t& board, std::ostream& out)
 /* print_result() checks to see if the game is over, and if so,
    prints the result. */
 
-int print_result(std::vector<chess_move>& workq, node_t& board)
+int print_result(move_list& workq, node_t& board)
 {
   size_t i;
 
@@ -11,13 +11,13 @@
 #include "parallel.hpp"
 
 void search_pt(boost::shared_ptr<search_info> info) {
-    info->result = search(info);
+    info->result = search(info.get());
     task_counter.add(1);
 }
 
-score_t search(boost::shared_ptr<search_info> info)
+score_t search(search_info *info)
 {
-    node_t board = info->board;
+    node_t& board = info->get_board();
     int depth = info->depth;
     assert(depth >= 0);
     // if we are a leaf node, return the value from the eval() function
@@ -44,7 +44,7 @@ score_t search(boost::shared_ptr<search_info> info)
 
     score_t val, max;
 
-    std::vector<chess_move> workq;
+    move_list workq;
     chess_move max_move;
     max_move = INVALID_MOVE;
 
@@ -68,44 +68,48 @@ score_t search(boost::shared_ptr<search_info> info)
         for(size_t j=0;j < workq.size(); j++) {
             bool last = (j+1)==workq.size();
             chess_move g = workq[j];
-            boost::shared_ptr<search_info> info{new search_info(board)};
-
-            if (makemove(info->board, g)) {  
-                DECL_SCORE(z,0,board.hash);
-                info->depth = depth-1;
-                info->mv = g;
-                info->result = z;
-                bool parallel=true;
-                bool skip = true;
-                if(depth == 1 && capture(board,g)) {
-                    if(mm==1) {
-                        boost::shared_ptr<task> t = 
-                            parallel_task(depth, &parallel);
-                        t->info = info;
+
+            DECL_SCORE(z,0,board.hash);
+            undo_t u;
+            if (makemove(board, g, u)) {  
+                bool qsearch = depth == 1 && capture(board,g);
+                if(qsearch == (mm==1)) {
+                    bool parallel=true;
+                    boost::shared_ptr<task> t = 
+                        parallel_task(depth, &parallel);
+                    search_info serial_info;
+                    search_info *info = t ? t->info.get() : &serial_info;
+                    info->depth = depth-1;
+                    info->mv = g;
+                    info->result = z;
+                    if(qsearch) {
                         DECL_SCORE(lo,-10000,0);
-                        t->info->beta = -max;
-                        t->info->alpha = lo;
-                        t->pfunc = qeval_f;
-                        tasks.push_back(t);
-                        t->start();
-                        skip = false;
+                        info->beta = -max;
+                        info->alpha = lo;
                     }
-                } else {
-                    if(mm==0) {
-                        boost::shared_ptr<task> t = 
-                            parallel_task(depth, &parallel);
-                        t->info = info;
-                        t->pfunc = search_f;
-                        tasks.push_back(t);
+                    if(t) {
+                        info->board = board;
+                        t->pfunc = qsearch ? qeval_f : search_f;
                         t->start();
-                        skip = false;
+                        tasks.push_back(t);
+                    } else {
+                        // searched right here, on our own board
+                        info->parent_board = &board;
+                        info->result = qsearch ? qeval(info) : search(info);
+                        val = -info->result;
+                        if (val > max)
+                        {
+                            max = val;
+                            max_move = g;
+                        }
                     }
                 }
+                unmakemove(board, u);
             }
             if(tasks.size()>=(size_t)num_proc||last) {
                 for(size_t n=0;n<tasks.size();n++) {
                     boost::shared_ptr<task> taskn = tasks[n];
-                    boost::shared_ptr<search_info> info = taskn->info;
+                    search_info *info = taskn->info.get();
                     taskn->join();
                     val = -taskn->info->result;
 
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  move_picker.cpp
+ */
+
+#include "move_picker.hpp"
+#include "board.hpp"
+#include <algorithm>
+#include <string.h>
+
+void order_table::clear()
+{
+    memset(killers, 0, sizeof(killers));
+    memset(history, 0, sizeof(history));
+}
+
+/* add_cutoff() is called when m cut off the search depth plies from
+   the leaves. Captures and promotions are ordered well enough without
+   our help. */
+
+void order_table::add_cutoff(int ply, int depth, chess_move& m)
+{
+    if (m.getBits() & (1 | 32))
+        return;
+    uint16_t k = m.get16BitMove();
+    if (ply < MAX_PLY && killers[ply][0] != k) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = k;
+    }
+    int& h = history[m.getFrom()][m.getTo()];
+    h += depth*depth;
+    // keep the scores well inside what chess_move::score can hold
+    if (h > (1 << 20)) {
+        for (int i = 0; i < 64; i++)
+            for (int j = 0; j < 64; j++)
+                history[i][j] /= 2;
+    }
+}
+
+move_picker::move_picker(const node_t& board_, uint16_t hash_move_, const order_table *order_)
+    : board(&board_), order(order_), stage(HASH_MOVE), hash_move(hash_move_), cur(0), nbad(0)
+{
+    killer[0] = killer[1] = 0;
+    if (order != 0 && board_.ply < MAX_PLY) {
+        killer[0] = order->killers[board_.ply][0];
+        killer[1] = order->killers[board_.ply][1];
+    }
+}
+
+bool move_picker::next(chess_move& m)
+{
+    for (;;) {
+        switch (stage) {
+            case HASH_MOVE:
+                stage = GEN_CAPTURES;
+                if (hash_move != 0 && decode_move(*board, hash_move, m))
+                    return true;
+                hash_move = 0;
+                break;
+            case GEN_CAPTURES:
+                gen_caps(moves, *board);
+                std::sort(moves.begin(), moves.end(), workq_sort);
+                cur = 0;
+                stage = CAPTURES;
+                break;
+            case CAPTURES:
+                while (cur < moves.size()) {
+                    m = moves[cur++];
+                    if (m.get16BitMove() == hash_move)
+                        continue;
+                    if (see(*board, m) < 0)
+                        moves[nbad++] = m;
+                    else
+                        return true;
+                }
+                cur = 0;
+                stage = KILLERS;
+                break;
+            case KILLERS:
+                // A killer comes from another position, so it may not
+                // be playable here; the captures and promotions we have
+                // already had.
+                while (cur < 2) {
+                    uint16_t k = killer[cur++];
+                    if (k != 0 && k != hash_move && decode_move(*board, k, m)
+                            && !(m.getBits() & (1 | 32)))
+                        return true;
+                    killer[cur-1] = 0;
+                }
+                stage = GEN_QUIETS;
+                break;
+            case GEN_QUIETS:
+                moves.truncate(nbad);
+                gen_quiets(moves, *board);
+                // gen_push() only scored the piece that moves, which
+                // now just breaks ties between equal history values
+                if (order != 0) {
+                    for (size_t i = nbad; i < moves.size(); i++)
+                        moves[i].score += 64*order->history[moves[i].getFrom()][moves[i].getTo()];
+                }
+                std::sort(moves.begin() + nbad, moves.end(), workq_sort);
+                cur = nbad;
+                stage = QUIETS;
+                break;
+            case QUIETS:
+                while (cur < moves.size()) {
+                    m = moves[cur++];
+                    uint16_t g = m.get16BitMove();
+                    if (g != hash_move && g != killer[0] && g != killer[1])
+                        return true;
+                }
+                cur = 0;
+                stage = BAD_CAPTURES;
+                break;
+            case BAD_CAPTURES:
+                if (cur < nbad) {
+                    m = moves[cur++];
+                    return true;
+                }
+                stage = DONE;
+                break;
+            default:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  perft.cpp
+ */
+
+#include "perft.hpp"
+#include "board.hpp"
+#include "main.hpp"
+#include "thread_pool.hpp"
+#include <boost/atomic.hpp>
+#include <fstream>
+#include <sstream>
+
+/* Subtree counts are cached the same lockless way as the
+   transposition table (see zkey.hpp): check holds the key
+   xor'ed with the count, so a torn entry never matches. */
+struct perft_entry {
+    boost::atomic<uint64_t> check;
+    boost::atomic<uint64_t> count;
+    perft_entry() : check(0), count(0) {}
+};
+
+static const size_t perft_entries = 1 << 20;
+static perft_entry *perft_table = 0;
+
+/* The low bits of the hash pick the entry, so they can make room
+   for the depth. */
+static inline uint64_t perft_key(const node_t& board, int depth)
+{
+    return (board.hash & ~uint64_t(0xFFFF)) | uint64_t(depth);
+}
+
+uint64_t perft(node_t& board, int depth, bool use_hash)
+{
+    if (depth == 0)
+        return 1;
+
+    uint64_t key = 0;
+    perft_entry *e = 0;
+    if (use_hash && depth > 1) {
+        key = perft_key(board, depth);
+        e = &perft_table[board.hash & (perft_entries - 1)];
+        uint64_t count = e->count.load(boost::memory_order_relaxed);
+        if ((e->check.load(boost::memory_order_relaxed) ^ count) == key)
+            return count;
+    }
+
+    move_list workq;
+    gen(workq, board);
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < workq.size(); ++i) {
+        undo_t u;
+        if (!makemove(board, workq[i], u))
+            continue;
+        // no need to go down a level just to count the leaves
+        nodes += (depth == 1) ? 1 : perft(board, depth - 1, use_hash);
+        unmakemove(board, u);
+    }
+
+    if (e != 0) {
+        e->check.store(key ^ nodes, boost::memory_order_relaxed);
+        e->count.store(nodes, boost::memory_order_relaxed);
+    }
+    return nodes;
+}
+
+struct perft_job : public pool_job {
+    node_t board;
+    chess_move mv;
+    int depth;
+    bool use_hash;
+    uint64_t nodes;
+
+    perft_job() : depth(0), use_hash(false), nodes(0) {}
+
+    void execute() {
+        nodes = perft(board, depth, use_hash);
+    }
+};
+
+uint64_t perft_root(const node_t& board, int depth, bool use_hash, bool divide)
+{
+    if (use_hash && perft_table == 0)
+        perft_table = new perft_entry[perft_entries];
+
+    int start = get_ms();
+    uint64_t nodes = 0;
+    if (depth <= 0) {
+        nodes = 1;
+    } else {
+        move_list workq;
+        gen(workq, board);
+        std::vector<perft_job> jobs(workq.size());
+        size_t n = 0;
+        for (size_t i = 0; i < workq.size(); ++i) {
+            perft_job& job = jobs[n];
+            job.board = board;
+            if (!makemove(job.board, workq[i]))
+                continue;
+            job.mv = workq[i];
+            job.depth = depth - 1;
+            job.use_hash = use_hash;
+            workers.submit(&job);
+            n++;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            workers.wait(&jobs[i]);
+            if (divide)
+                std::cout << move_str(jobs[i].mv) << ": " << jobs[i].nodes << std::endl;
+            nodes += jobs[i].nodes;
+        }
+        if (divide)
+            std::cout << "Moves: " << n << std::endl;
+    }
+    int ms = get_ms() - start;
+
+    std::cout << "perft " << depth << ": " << nodes << " nodes, "
+        << ms << " ms";
+    if (ms > 0)
+        std::cout << " (" << uint64_t(nodes * 1000.0 / ms) << " nodes/sec)";
+    std::cout << std::endl;
+    return nodes;
+}
+
+bool perft_suite(const std::string& filename, int max_depth, bool use_hash)
+{
+    std::ifstream suite(filename.c_str());
+    if (!suite.is_open()) {
+        std::cerr << "Unable to open file" << std::endl;
+        return false;
+    }
+
+    int start = get_ms();
+    uint64_t total = 0;
+    int failed = 0;
+    std::string line;
+    while (std::getline(suite, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t semi = line.find(';');
+        std::string fen = line.substr(0, semi);
+        node_t board;
+        if (!set_fen(board, fen)) {
+            std::cout << "Bad FEN: " << fen << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << fen << std::endl;
+        while (semi != std::string::npos) {
+            size_t next = line.find(';', semi + 1);
+            std::istringstream field(line.substr(semi + 1, next - semi - 1));
+            semi = next;
+            std::string name;
+            uint64_t expected;
+            if (!(field >> name >> expected) || name.size() < 2 || name[0] != 'D')
+                continue;
+            int depth = atoi(name.c_str() + 1);
+            if (depth > max_depth)
+                continue;
+            uint64_t nodes = perft_root(board, depth, use_hash, false);
+            total += nodes;
+            if (nodes != expected) {
+                std::cout << "FAILED: expected " << expected << std::endl;
+                failed++;
+            }
+        }
+    }
+    int ms = get_ms() - start;
+
+    std::cout << "Total: " << total << " nodes, " << ms << " ms";
+    if (ms > 0)
+        std::cout << " (" << uint64_t(total * 1000.0 / ms) << " nodes/sec)";
+    std::cout << std::endl;
+    if (failed == 0)
+        std::cout << "All counts correct" << std::endl;
+    else
+        std::cout << failed << " counts FAILED" << std::endl;
+    return failed == 0;
+}
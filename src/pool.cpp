@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  pool.cpp
+ */
+
+#include "pool.hpp"
+#include <stdlib.h>
+
+thread_local uint64_t heap_allocs = 0;
+
+// HPX brings its own allocator, so we leave operator new alone there
+#ifndef HPX_SUPPORT
+void *operator new(size_t n)
+{
+    heap_allocs++;
+    void *p = malloc(n ? n : 1);
+    if (p == 0)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+#endif
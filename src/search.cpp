@@ -20,6 +20,9 @@
 #include "here.hpp"
 #include "zkey.hpp"
 #include "log_board.hpp"
+#include "pool.hpp"
+#include "time_control.hpp"
+#include <boost/make_shared.hpp>
 #include <fstream>
 #include <sstream>
 
@@ -29,7 +32,42 @@ const int num_proc = chx_threads_per_proc();
 int min(int a,int b) { return a < b ? a : b; }
 int max(int a,int b) { return a > b ? a : b; }
 
-std::vector<safe_move> pv;  // Principle Variation, used in iterative deepening
+pv_line pv;  // Principle Variation of the last think()
+
+thread_local uint64_t nodes_searched = 0;  // nodes visited by this thread
+boost::atomic<uint64_t> nodes_total(0);
+
+static boost::atomic<int> search_id(0);  // think() calls so far
+
+/* The root of the abort chain of every search think() does past its
+   first iteration. The move_timer aborts it at the hard limit. */
+static search_info search_stop;
+
+void set_search_stop(bool stop)
+{
+    search_stop.set_abort(stop);
+}
+
+void (*iteration_done)(int depth,score_t score,const pv_line& pv) = 0;
+
+/* How deep a search with a clock may go. It is meant to run out of
+   time long before. */
+#define MAX_TIMED_DEPTH (MAX_PLY - 1)
+static thread_local order_table order;
+
+/* get_order_table() returns this thread's killers and history. The
+   threads can't clear each other's, so each one clears its own the
+   first time it looks at it in a new search. */
+
+order_table& get_order_table()
+{
+    int id = search_id.load(boost::memory_order_relaxed);
+    if (order.search_id != id) {
+        order.clear();
+        order.search_id = id;
+    }
+    return order;
+}
 
 /**
  * This determines whether we have a capture. It's not sophisticated
@@ -46,13 +84,14 @@ bool capture(const node_t& board,chess_move& g) {
 /**
  * Quiescent evaluator. Originally we wished to avoid the complexity
  * of quiescent chess_move searches, but MTD-f does not seem to work properly
- * without it. This particular search evaluates each chess_move using the
- * evalutaor, unless the chess_move is a capture then it calls itself
- * recursively. The quiescent chess_move search uses alpha-beta to speed
- * itself along, and evaluates non-captures first to get the greatest
- * cutoff.
+ * without it. This is a "standing pat" search: the side to move can
+ * always decline to capture, so the evaluator's score is a lower
+ * bound, and only captures and promotions are searched from here.
+ * They are tried in the order of what they win by see(), and the
+ * ones that lose material are not tried at all. The quiescent chess_move
+ * search uses alpha-beta to speed itself along.
  **/
-score_t qeval(boost::shared_ptr<search_info> info)
+score_t qeval(search_info *info)
 {
 #ifdef HPX_SUPPORT
     if(file_output_enabled) {
@@ -64,47 +103,40 @@ score_t qeval(boost::shared_ptr<search_info> info)
             streams[n]->open(outname.str());
             std::cout << "file: " << outname.str() << std::endl;
         }
-        log_board(info->board,*streams[n]);
+        log_board(info->get_board(),*streams[n]);
     }
 #endif
-    node_t board = info->board;
+    count_node();
+    node_t& board = info->get_board();
     score_t lower = info->alpha;
     score_t upper = info->beta;
     evaluator ev;
     DECL_SCORE(s,ev.eval(board, chosen_evaluator),board.hash);
+    if(s > upper)
+        return s;  // standing pat is already too good
     s = max(lower,s);
-    std::vector<chess_move> workq;
-    gen(workq, board); // Generate the moves
-    for(size_t j=0;j < workq.size(); j++) {
-        chess_move g = workq[j];
-        if(g.getCapture())
-            continue;
-        if(info->get_abort())
-            return s;
-        node_t p_board = board;
-        if(!makemove(p_board,g))
-            continue;
-        DECL_SCORE(v,ev.eval(p_board,chosen_evaluator),p_board.hash);
-        s = max(v,s);
-        if(s > upper) {
-            return s;
-        }
-    }
+    move_list workq;
+    gen_caps(workq, board);
+    for(size_t j=0;j < workq.size(); j++)
+        workq[j].score = see(board, workq[j]);
+    std::sort(workq.begin(), workq.end(), workq_sort);
     for(size_t j=0;j < workq.size(); j++) {
-        if(!workq[j].getCapture())
-            continue;
+        // a losing capture won't raise s, so we don't search it
+        if(workq[j].score < 0)
+            break;
         if(info->get_abort())
             return s;
         chess_move g = workq[j];
-        node_t p_board = board;
-        if(!makemove(p_board,g))
+        undo_t u;
+        if(!makemove(board,g,u))
             continue;
-        boost::shared_ptr<search_info> new_info{new search_info};
-        new_info->set_abort_ref(info.get());
-        new_info->board = p_board;
-        new_info->alpha = -upper;
-        new_info->beta = -lower;
-        s = max(-qeval(new_info),s);
+        search_info new_info;
+        new_info.set_abort_ref(info);
+        new_info.parent_board = &board;
+        new_info.alpha = -upper;
+        new_info.beta = -s;  // s is never below lower
+        s = max(-qeval(&new_info),s);
+        unmakemove(board,u);
         if(s > upper) {
             return s;
         }
@@ -114,137 +146,282 @@ score_t qeval(boost::shared_ptr<search_info> info)
 
 void qeval_pt(boost::shared_ptr<search_info> info)
 {
-  info->result = qeval(info);
+  info->result = qeval(info.get());
   task_counter.add(1);
 }
 
+/* parallel_task() returns a task, with a search_info of its own, for
+   a child that is to be searched on another thread. If the child is
+   to be searched serially it returns nothing: the caller searches it
+   right away with a search_info on its own stack, so the serial path
+   allocates nothing. The tasks come from per-thread pools. */
+
 boost::shared_ptr<task> parallel_task(int depth, bool *parallel) {
 
-    if(!*parallel) {
-        boost::shared_ptr<task> t{new serial_task};
-        return t;
+    // Lazy SMP threads only share the transposition table
+    if(!*parallel || search_method == LAZYSMP) {
+        *parallel = false;
+        return boost::shared_ptr<task>();
     }
     bool use_parallel = false;
-    use_parallel = depth >= 3;
+    use_parallel = depth >= split_depth;
     if(use_parallel) {
         int n = task_counter.dec();
         if(n > 0) {
 #ifdef HPX_SUPPORT
             boost::shared_ptr<task> t{new hpx_task};
 #else
-            boost::shared_ptr<task> t{new thread_task};
+            boost::shared_ptr<task> t =
+                boost::allocate_shared<thread_task>(pool_allocator<thread_task>());
 #endif
+            t->info = boost::allocate_shared<search_info>(pool_allocator<search_info>());
             *parallel = (n > 1);
             return t;
         }
     }
     *parallel = false;
-    boost::shared_ptr<task> t{new serial_task};
-    return t;
+    return boost::shared_ptr<task>();
+}
+
+/**
+ * One thread of a Lazy SMP search. Each thread runs its own iterative
+ * deepening over the same root, serially, and the threads only talk
+ * through the transposition table: whatever one of them stores makes
+ * the others' searches cheaper. Odd numbered helpers start one ply
+ * deeper so the threads don't all work on the same depth at once.
+ */
+struct lazy_thread : public pool_job {
+    node_t board;
+    search_info *stop;  // set when the main thread is done
+    const move_timer *timer;  // null without a clock
+    int id;
+    int max_depth;
+    int depth_reached;
+    uint64_t nodes;
+    score_t f;
+    pv_line pv;  // this thread's own, from its last iteration
+
+    lazy_thread() : stop(0), timer(0), id(0), max_depth(0), depth_reached(0), nodes(0), f(0) {}
+
+    void execute() {
+        uint64_t start = nodes_searched;
+        DECL_SCORE(alpha,-10000,board.hash);
+        DECL_SCORE(beta,10000,board.hash);
+        for (int d = 1 + (id & 1); d <= max_depth; d++) {
+            if (id == 0 && timer != 0 && depth_reached > 0 && timer->past_soft_limit())
+                break;
+            board.depth = d;
+            search_info info;
+            // the main thread's first iteration always finishes, so
+            // there is a chess_move to play
+            if (id != 0 || depth_reached > 0)
+                info.set_abort_parent(stop);
+            info.helper = (id != 0);
+            info.board = board;
+            info.depth = d;
+            info.alpha = alpha;
+            info.beta = beta;
+            info.prev_pv = &pv;
+            score_t s = search_ab(&info);
+            if (info.get_abort())
+                break;
+            f = s;
+            pv = info.pv;
+            depth_reached = d;
+            if (id == 0 && iteration_done != 0)
+                iteration_done(d, f, pv);
+        }
+        nodes = nodes_searched - start;
+    }
+};
+
+score_t lazy_smp(node_t& board,const move_timer *timer)
+{
+    search_info stop;
+    stop.set_abort_parent(&search_stop);
+    int nthreads = 1;
+#ifndef HPX_SUPPORT
+    nthreads += workers.size();
+#endif
+    std::vector<lazy_thread> threads(nthreads);
+    for (int i = 0; i < nthreads; i++) {
+        threads[i].board = board;
+        threads[i].stop = &stop;
+        threads[i].timer = timer;
+        threads[i].id = i;
+        threads[i].max_depth = timer ? MAX_TIMED_DEPTH : depth[board.side];
+    }
+#ifndef HPX_SUPPORT
+    for (int i = 1; i < nthreads; i++)
+        workers.submit(&threads[i]);
+#endif
+    // The main thread decides the chess_move; once it is
+    // done the helpers are stopped wherever they are.
+    threads[0].execute();
+    stop.set_abort(true);
+#ifndef HPX_SUPPORT
+    for (int i = 1; i < nthreads; i++)
+        workers.wait(&threads[i]);
+#endif
+
+    if (bench_mode) {
+        uint64_t total = 0;
+        for (int i = 0; i < nthreads; i++) {
+            std::cout << "  thread " << i << ": depth " << threads[i].depth_reached
+                << ", nodes " << threads[i].nodes << std::endl;
+            total += threads[i].nodes;
+        }
+        std::cout << "  total nodes: " << total << std::endl;
+    }
+    pv = threads[0].pv;
+    return threads[0].f;
 }
 
 // think() calls a search function 
 int think(node_t& board,bool parallel)
 {
-  boost::shared_ptr<task> root{new serial_task};
-#ifdef PV_ON
   pv.clear();
-  pv.resize(depth[board.side]);
-  chess_move mvz;
-  mvz = INVALID_MOVE;
-  for(size_t i=0;i<pv.size();i++) {
-    pv[i].set(mvz);
-  }
-#endif
-  for(int i=0;i<table_size;i++) {
-    transposition_table[i].depth = -1;
-    transposition_table[i].lower = bad_min_score;
-    transposition_table[i].upper = bad_max_score;
-  }
+  age_transposition_table();
+  search_id++;  // forget the killers and history of the last search
   board.ply = 0;
 
+  // minimax is the fixed workload, it always goes to depth[]
+  move_timer timer;
+  const bool timed = search_method != MINIMAX && timer.start(board.side, &search_stop);
+
   if (search_method == MINIMAX) {
-    root->pfunc = search_f;
     
-    boost::shared_ptr<search_info> info{new search_info};
-    info->board = board;
-    info->depth = depth[board.side];
-    score_t f = search(info);
+    search_info info;
+    info.board = board;
+    info.depth = depth[board.side];
+    score_t f = search(&info);
     
     assert(move_to_make != INVALID_MOVE);
     if (bench_mode)
       std::cout << "SCORE=" << f << std::endl;
-  } else if (search_method == MTDF) {
-    root->pfunc = search_ab_f;
-    DECL_SCORE(alpha,-10000,board.hash);
-    DECL_SCORE(beta,10000,board.hash);
-    int stepsize = 2;
-    int d = depth[board.side] % stepsize;
-    if(d == 0)
-        d = stepsize;
-    board.depth = d;
-    boost::shared_ptr<search_info> info{new search_info};
-    info->board = board;
-    info->depth = d;
-    info->alpha = alpha;
-    info->beta = beta;
-    score_t f(search_ab(info));
-    while(d < depth[board.side]) {
-        d+=stepsize;
-        board.depth = d;
-        f = mtdf(board,f,d);
-        boost::shared_ptr<task> new_root{new serial_task};
-        root = new_root;
-    }
+  } else if (search_method == MTDF || search_method == ALPHABETA) {
+    score_t f = iterate(board, timed ? &timer : 0);
     if (bench_mode)
       std::cout << "SCORE=" << f << std::endl;
-  } else if (search_method == ALPHABETA) {
-    root->pfunc = search_ab_f;
-    // Initially alpha is -infinity, beta is infinity
-    DECL_SCORE(f,0,0);
+  } else if (search_method == LAZYSMP) {
+    score_t f = lazy_smp(board, timed ? &timer : 0);
+    if (bench_mode)
+      std::cout << "SCORE=" << f << std::endl;
+  }
+  timer.stop();
+  search_stop.set_abort(false);
+  return 1;
+}
+
+/* iterate() is the iterative deepening driver of ALPHABETA and MTDF.
+   The first depth (one or two, whichever has the parity of the final
+   depth) is searched with a full window, and every later one around
+   the score of the one before: by MTD-f two plies at a time, so the
+   guess comes from a search with the same side to move at the
+   leaves, or by aspiration() one ply at a time. ALPHABETA goes
+   straight to the final depth once it has done iter_depth.
+
+   With a timer there is no final depth to speak of: the iterations
+   go on until the soft limit has passed, or the hard limit aborts
+   one, which is then thrown away. The first is never aborted. The
+   chess_move played is the first of pv, which aspiration() and mtdf()
+   only replace with a line that failed high or finished: a root
+   chess_move that failed high in the aborted iteration has already
+   beaten the last one's best. */
+
+score_t iterate(node_t& board,const move_timer *timer)
+{
+    const int final_depth = timer ? MAX_TIMED_DEPTH : depth[board.side];
+    const int step = (search_method == MTDF) ? 2 : 1;
+    int d = (final_depth % 2 == 1) ? 1 : 2;
+    if (d > final_depth)
+        d = final_depth;
+
     DECL_SCORE(alpha,-10000,board.hash);
     DECL_SCORE(beta,10000,board.hash);
-    bool brk = false;  /* Indicates whether we broke away from iterative deepening 
-                          and need to call search on the actual ply */
-
-    int low = 2;
-    if(depth[board.side] % 2 == 1)
-        low = 1;
-    for (int i = low; i <= depth[board.side]; i++) // Iterative deepening
-    {
-      board.depth = i;
-      boost::shared_ptr<search_info> info{new search_info};
-      info->board = board;
-      info->depth = i;
-      info->alpha = alpha;
-      info->beta = beta;
-      f = search_ab(info);
-
-      if (i >= iter_depth)  // if our ply is greater than the iter_depth, then break
-      {
-        brk = true;
-        break;
-      }
-      boost::shared_ptr<task> new_root{new serial_task};
-      root = new_root;
+    board.depth = d;
+    search_info info;
+    info.board = board;
+    info.depth = d;
+    info.alpha = alpha;
+    info.beta = beta;
+    score_t f = search_ab(&info);
+    pv = info.pv;
+    if (iteration_done != 0)
+        iteration_done(d, f, pv);
+    while (d < final_depth) {
+        if (timer != 0 && timer->past_soft_limit())
+            break;
+        if (search_method == ALPHABETA && d >= iter_depth && timer == 0)
+            d = final_depth;
+        else
+            d = min(d + step, final_depth);
+        board.depth = d;
+        const chess_move best = move_to_make;
+        score_t g;
+        if (search_method == MTDF)
+            g = mtdf(board,f,d,pv);
+        else
+            g = aspiration(board,f,d,pv);
+        if (search_stop.get_abort()) {
+            // pv is the last iteration's, unless a chess_move failed high
+            move_to_make = (pv.length > 0) ? pv.moves[0] : best;
+            break;
+        }
+        f = g;
+        if (iteration_done != 0)
+            iteration_done(d, f, pv);
     }
+    return f;
+}
+
+/* aspiration() searches to depth with a window of aspiration_width on
+   either side of f, the score of the last iteration, so that most of
+   the tree is cut off sooner than a full window allows. If the score
+   falls outside, the window is widened on that side, twice as far
+   each time, and searched again. An aspiration_width of 0 searches
+   the full window right away. pv works as in mtdf(). If the search
+   is aborted, what it returns means nothing and pv is left alone. */
 
-    if (brk) {
-      boost::shared_ptr<search_info> info{new search_info};
-      info->board = board;
-      info->depth = depth[board.side];
-      info->alpha = alpha;
-      info->beta = beta;
-      f=search_ab(info);
+score_t aspiration(const node_t& board,score_t f,int depth,pv_line& pv)
+{
+    DECL_SCORE(lower,-10000,board.hash);
+    DECL_SCORE(upper,10000,board.hash);
+    int width = aspiration_width;
+    score_t alpha = lower, beta = upper;
+    if (width > 0) {
+        alpha = max(lower,ADD_SCORE(f,-width));
+        beta = min(upper,ADD_SCORE(f,width));
+    }
+    for(;;) {
+        search_info info;
+        info.board = board;
+        info.depth = depth;
+        info.alpha = alpha;
+        info.beta = beta;
+        info.prev_pv = &pv;
+        info.set_abort_parent(&search_stop);
+        score_t g = search_ab(&info);
+        if (info.get_abort())
+            return g;
+        if (info.pv.length > 0)
+            pv = info.pv;
+        if (g <= alpha && alpha > lower) {
+            width *= 2;
+            alpha = max(lower,ADD_SCORE(alpha,-width));
+        } else if (g >= beta && beta < upper) {
+            width *= 2;
+            beta = min(upper,ADD_SCORE(beta,width));
+        } else {
+            return g;
+        }
     }
-    if (bench_mode)
-      std::cout << "SCORE=" << f << std::endl;
-  }
-  return 1;
 }
 
-/** MTD-f */
-score_t mtdf(const node_t& board,score_t f,int depth)
+/** MTD-f. pv holds the principal variation of the last iteration
+    on the way in, and the new one on the way out, unless the search
+    is aborted. */
+score_t mtdf(const node_t& board,score_t f,int depth,pv_line& pv)
 {
     score_t g = f;
     DECL_SCORE(upper,10000,board.hash);
@@ -254,37 +431,48 @@ score_t mtdf(const node_t& board,score_t f,int depth)
     // better with a coarser evaluation function. Since
     // this maps readily onto a wider, non-zero width
     // we provide a width setting for optimization.
-    const int start_width = 4;//atoi(getenv("START_WIDTH"));
+    const int start_width = mtdf_start_width;
     // Sometimes MTD-f gets stuck and can try many
     // times without finding an answer. If this happens
     // we want to set a threshold for bailing out.
-    const int max_tries = 4;//atoi(getenv("MAX_TRIES"));
+    const int max_tries = mtdf_max_tries;
     // If our first guess isn't right, chances are
     // we want to search a little wider the next try
     // to improve our odds.
-    const int grow_width = 4;//atoi(getenv("GROW_WIDTH"));
+    const int grow_width = mtdf_grow_width;
     int width = start_width;
     const int max_width = start_width+grow_width*max_tries;
     score_t alpha = lower, beta = upper;
     while(lower < upper) {
         if(width >= max_width) {
-            boost::shared_ptr<search_info> info{new search_info};
-            info->board = board;
-            info->depth = depth;
-            info->alpha = lower;
-            info->beta = upper;
-            g = search_ab(info);
+            search_info info;
+            info.board = board;
+            info.depth = depth;
+            info.alpha = lower;
+            info.beta = upper;
+            info.prev_pv = &pv;
+            info.set_abort_parent(&search_stop);
+            g = search_ab(&info);
+            if (info.pv.length > 0 && !info.get_abort())
+                pv = info.pv;
             break;
         } else {
             alpha = max(g == lower ? lower+1 : lower,ADD_SCORE(g,    -(1+width/2)));
             beta  = min(g == upper ? upper-1 : upper,ADD_SCORE(alpha, (1+width)));
         }
-        boost::shared_ptr<search_info> info{new search_info};
-        info->board = board;
-        info->depth = depth;
-        info->alpha = alpha;
-        info->beta = beta;
-        g = search_ab(info);
+        search_info info;
+        info.board = board;
+        info.depth = depth;
+        info.alpha = alpha;
+        info.beta = beta;
+        info.prev_pv = &pv;
+        info.set_abort_parent(&search_stop);
+        g = search_ab(&info);
+        if (info.get_abort())
+            break;
+        // a search that failed low has no line to offer
+        if (info.pv.length > 0)
+            pv = info.pv;
         if(g < beta) {
             if(g > alpha)
                 break;
@@ -308,67 +496,10 @@ int reps(const node_t& board)
   int i;
   int r = 0;
 
-  for (i = 0; i < board.fifty; ++i) {
-    assert(i < board.hist_dat.size());
+  for (i = 0; i < board.fifty && i < board.hist_dat.size(); ++i) {
     assert(board.hash != 0);
     if (board.hist_dat[i] == board.hash)
       ++r;
   }
   return r;
 }
-
-void sort_pv(std::vector<chess_move>& workq, int index)
-{
-  if((size_t)index < pv.size())
-    return;
-  chess_move temp = pv[index].get();
-  if(temp == INVALID_MOVE)
-    return;
-  for(size_t i = 0; i < workq.size() ; i++)
-  {
-    if (workq[i] == temp) /* If we have a chess_move in the work queue that is the 
-                                    same as the best chess_move we have searched before */
-    {
-      temp = workq[0];
-      workq[0] = workq[i];
-      workq[i] = temp;
-      break;
-    }
-  }
-}
-
-#define TRANSPOSE_ON 1
-
-zkey_t transposition_table[table_size];
-
-bool get_transposition_value(const node_t& board,score_t& lower,score_t& upper) {
-    bool gotten = false;
-#ifdef TRANSPOSE_ON
-    int n = abs(board.hash^board.depth) % table_size;
-    zkey_t *z = &transposition_table[n];
-    ScopedLock s(z->mut);
-    if(z->depth >= 0 && board_equals(board,z->board)) {
-        lower = z->lower;
-        upper = z->upper;
-        gotten = true;
-    } else {
-        lower = bad_min_score;
-        upper = bad_max_score;
-    }
-#endif
-    return gotten;
-}
-
-void set_transposition_value(const node_t& board,score_t lower,score_t upper) {
-#ifdef TRANSPOSE_ON
-    int n = abs(board.hash^board.depth) % table_size;
-    zkey_t *z = &transposition_table[n];
-    ScopedLock s(z->mut);
-    if(board.depth >= z->depth) {
-        z->board = board;
-        z->lower = lower;
-        z->upper = upper;
-        z->depth = board.depth;
-    }
-#endif
-}
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  thread_pool.cpp
+ */
+
+#include "thread_pool.hpp"
+
+thread_pool workers;
+
+// Which deque the current thread pushes to. Workers get 1..n,
+// everybody else shares 0.
+static thread_local int pool_slot = 0;
+
+void thread_pool::start(int nthreads)
+{
+    stop();
+    for (int i = 0; i <= nthreads; i++)
+        queues.push_back(new job_queue);
+    for (int i = 1; i <= nthreads; i++)
+        threads.push_back(std::thread(&thread_pool::worker, this, i));
+}
+
+void thread_pool::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(sleep_mut);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    threads.clear();
+    for (size_t i = 0; i < queues.size(); i++)
+        delete queues[i];
+    queues.clear();
+    pending = 0;
+    stopping = false;
+}
+
+void thread_pool::run(pool_job *job)
+{
+    job->execute();
+    // The owner may free the job as soon as it sees this,
+    // so it must be the last thing we touch.
+    job->state.store(pool_job::done, boost::memory_order_release);
+}
+
+/* find_job() takes the newest job from our own deque, or failing that
+   steals the oldest job from another one. */
+
+pool_job *thread_pool::find_job(int slot)
+{
+    const int n = queues.size();
+    for (int k = 0; k < n; k++) {
+        job_queue *q = queues[(slot+k) % n];
+        pool_job *job = 0;
+        {
+            ScopedLock s(q->mut);
+            if (q->jobs.empty())
+                continue;
+            if (k == 0) {
+                job = q->jobs.back();
+                q->jobs.pop_back();
+            } else {
+                job = q->jobs.front();
+                q->jobs.pop_front();
+            }
+            job->state = pool_job::running;
+        }
+        pending--;
+        return job;
+    }
+    return 0;
+}
+
+/* unqueue() takes a job back out of its deque if no worker has taken
+   it yet. The owner usually joins its newest job first, so we look
+   from the back. */
+
+bool thread_pool::unqueue(pool_job *job)
+{
+    job_queue *q = queues[job->slot];
+    ScopedLock s(q->mut);
+    for (std::deque<pool_job *>::reverse_iterator i = q->jobs.rbegin();
+            i != q->jobs.rend(); ++i) {
+        if (*i == job) {
+            q->jobs.erase(--(i.base()));
+            job->state = pool_job::running;
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::worker(int slot)
+{
+    pool_slot = slot;
+    for (;;) {
+        pool_job *job = find_job(slot);
+        if (job != 0) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> l(sleep_mut);
+        if (stopping)
+            break;
+        wake.wait(l, [this] { return pending > 0 || stopping; });
+    }
+}
+
+void thread_pool::submit(pool_job *job)
+{
+    job->state = pool_job::queued;
+    job->slot = pool_slot;
+    if (queues.empty())
+        return;  // no workers, wait() will run it
+    {
+        job_queue *q = queues[pool_slot];
+        ScopedLock s(q->mut);
+        q->jobs.push_back(job);
+    }
+    {
+        std::lock_guard<std::mutex> l(sleep_mut);
+        pending++;
+    }
+    wake.notify_one();
+}
+
+/* wait() returns once the job has run. If no worker has picked it up
+   yet we run it ourselves; otherwise we help with other jobs rather
+   than block a thread the search could be using. */
+
+void thread_pool::wait(pool_job *job)
+{
+    if (job->state == pool_job::idle)
+        return;
+    if (queues.empty() || unqueue(job)) {
+        if (job->state == pool_job::queued)
+            job->state = pool_job::running;
+        run(job);
+        return;
+    }
+    while (!job->finished()) {
+        pool_job *other = find_job(pool_slot);
+        if (other != 0)
+            run(other);
+        else
+            std::this_thread::yield();
+    }
+}
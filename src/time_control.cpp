@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  time_control.cpp
+ */
+
+#include "time_control.hpp"
+#include "data.hpp"
+
+/* Kept back from the clock for the time it takes to get the chess_move to
+   the other side, and the moves assumed to be left in a game where
+   moves_to_go doesn't say. */
+#define MOVE_OVERHEAD_MS 50
+#define DEFAULT_MOVES_TO_GO 30
+
+bool move_budget(int side, int& soft_ms, int& hard_ms)
+{
+    if (move_time_ms > 0) {
+        hard_ms = move_time_ms;
+        soft_ms = move_time_ms / 2;
+        return true;
+    }
+    if (clock_ms[side] < 0)
+        return false;
+    int left = clock_ms[side] - MOVE_OVERHEAD_MS;
+    if (left < 1)
+        left = 1;
+    int mtg = (moves_to_go > 0) ? moves_to_go : DEFAULT_MOVES_TO_GO;
+    int budget = left / mtg + inc_ms[side];
+    // one chess_move may go over its budget, but never uses up the clock
+    hard_ms = 3 * budget;
+    if (hard_ms > left)
+        hard_ms = left;
+    if (budget > hard_ms)
+        budget = hard_ms;
+    // an iteration takes a few times as long as the one before it
+    soft_ms = budget / 2;
+    return true;
+}
+
+bool move_timer::start(int side, search_info *stop)
+{
+    this->stop();
+    start_time = clock::now();
+    if (!move_budget(side, soft_ms, hard_ms))
+        return false;
+    done = false;
+    thread = std::thread(&move_timer::run, this, stop);
+    return true;
+}
+
+void move_timer::stop()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> l(mut);
+        done = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+int move_timer::elapsed_ms() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_time).count();
+}
+
+void move_timer::run(search_info *stop)
+{
+    std::unique_lock<std::mutex> l(mut);
+    if (!wake.wait_until(l, start_time + std::chrono::milliseconds(hard_ms), [this] { return done; }))
+        stop->set_abort(true);
+}
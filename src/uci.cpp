@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2012 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  uci.cpp
+ */
+
+/* uci() is a substitute for chx_main() that speaks the Universal Chess
+   Interface. See the following page for details:
+http://wbec-ridderkerk.nl/html/UCIProtocol.html
+
+   The searches run on a thread of their own, so that "stop" and
+   "isready" are answered while one runs. It is started once and waits
+   for each "go", so that what it keeps in thread_local storage, from
+   its task pools to its history and pawn tables, lasts from one
+   search to the next. It reports every iteration that finishes
+   with an info line, and its chess_move with "bestmove" once it is done
+   or stopped. */
+
+#include "search.hpp"
+#include "zkey.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <stdlib.h>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+static std::mutex out_mut;  // the two threads both write to std::cout
+static std::mutex search_mut;  // guards the flags below
+static std::condition_variable search_wake;
+static bool searching;  // from "go" until bestmove is out
+static bool stop_requested;  // by "stop" or "quit"
+static bool quitting;
+static bool infinite;  // "go infinite": bestmove waits for "stop"
+static node_t search_board;
+static int default_depth[2];  // the depths when uci() started
+static std::thread search_thread;
+
+// only touched by the search thread while it runs
+static std::chrono::steady_clock::time_point go_time;
+static uint64_t go_nodes;
+
+/* The score in centipawns, without the hash bits that break ties. */
+static int score_base(score_t s)
+{
+#if SCORE_TYPE == CLASS_SCORE
+    return s.base;
+#elif SCORE_TYPE == LONG_SCORE
+    return s >> BITS;
+#else
+    return s;
+#endif
+}
+
+/* report() is the iteration_done of a UCI search. */
+static void report(int depth,score_t score,const pv_line& line)
+{
+    int ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - go_time).count();
+    uint64_t nodes = all_nodes() - go_nodes;
+    std::ostringstream info;
+    info << "info depth " << depth;
+    int s = score_base(score);
+    // a mate is scored -10000 plus the ply it happens at
+    if (s > 9000)
+        info << " score mate " << (10000 - s + 1) / 2;
+    else if (s < -9000)
+        info << " score mate " << -(10000 + s) / 2;
+    else
+        info << " score cp " << s;
+    info << " nodes " << nodes << " nps " << (ms > 0 ? nodes * 1000 / ms : nodes)
+        << " time " << ms;
+    if (line.length > 0) {
+        info << " pv";
+        for (int i = 0; i < line.length; i++) {
+            chess_move m = line.moves[i];
+            info << " " << move_str(m);
+        }
+    }
+    std::lock_guard<std::mutex> l(out_mut);
+    std::cout << info.str() << std::endl;
+}
+
+static void run_search(node_t board)
+{
+    go_time = std::chrono::steady_clock::now();
+    go_nodes = all_nodes();
+    move_to_make.set32BitMove(0);
+    think(board, false);
+    if (infinite) {
+        std::unique_lock<std::mutex> l(search_mut);
+        search_wake.wait(l, [] { return stop_requested; });
+    }
+    std::lock_guard<std::mutex> l(out_mut);
+    if (move_to_make.get32BitMove() == 0)
+        std::cout << "bestmove 0000" << std::endl;
+    else
+        std::cout << "bestmove " << move_str(move_to_make) << std::endl;
+}
+
+/* The search thread runs a search for every "go" until "quit". */
+static void search_loop()
+{
+    std::unique_lock<std::mutex> l(search_mut);
+    for (;;) {
+        search_wake.wait(l, [] { return searching || quitting; });
+        if (quitting)
+            return;
+        l.unlock();
+        run_search(search_board);
+        l.lock();
+        searching = false;
+        search_wake.notify_all();
+    }
+}
+
+/* Stops the search, if one is running, and waits for its bestmove. */
+static void stop_thinking()
+{
+    std::unique_lock<std::mutex> l(search_mut);
+    if (!searching)
+        return;
+    stop_requested = true;
+    set_search_stop(true);
+    search_wake.notify_all();
+    search_wake.wait(l, [] { return !searching; });
+}
+
+/* Waits for a search that stops by itself, as all but "go infinite"
+   do, before anything else may touch the globals it reads. */
+static void wait_for_search()
+{
+    if (infinite) {
+        stop_thinking();
+        return;
+    }
+    std::unique_lock<std::mutex> l(search_mut);
+    search_wake.wait(l, [] { return !searching; });
+}
+
+/* Makes the moves, in coordinate notation, that follow in in. If one
+   is illegal it is left in s. */
+static bool play_moves(node_t& board,std::istringstream& in,std::string& s)
+{
+    while (in >> s) {
+        move_list workq;
+        gen(workq, board);
+        int m = parse_move(workq, s.c_str());
+        chess_move mov;
+        mov = m;
+        if (m == -1 || !makemove(board, mov))
+            return false;
+    }
+    board.ply = 0;
+    return true;
+}
+
+static void position(node_t& board,std::istringstream& in)
+{
+    std::string s;
+    in >> s;
+    node_t newboard;
+    if (s == "startpos") {
+        init_board(newboard);
+        in >> s;
+    } else if (s == "fen") {
+        std::string fen;
+        while (in >> s && s != "moves")
+            fen += s + " ";
+        if (!set_fen(newboard, fen)) {
+            std::lock_guard<std::mutex> l(out_mut);
+            std::cout << "info string invalid FEN: " << fen << std::endl;
+            return;
+        }
+    } else {
+        return;
+    }
+    if (s == "moves" && !play_moves(newboard, in, s)) {
+        std::lock_guard<std::mutex> l(out_mut);
+        std::cout << "info string illegal chess_move " << s << std::endl;
+        return;
+    }
+    board = newboard;
+}
+
+static void go(const node_t& board,std::istringstream& in)
+{
+    clock_ms[LIGHT] = clock_ms[DARK] = -1;
+    inc_ms[LIGHT] = inc_ms[DARK] = 0;
+    moves_to_go = 0;
+    move_time_ms = 0;
+    depth[LIGHT] = depth[DARK] = MAX_PLY - 1;
+    // only "go infinite" and a bare "go" wait for "stop"
+    infinite = !(in >> std::ws).good();
+    bool to_depth = false;
+    std::string s;
+    while (in >> s) {
+        int n = 0;
+        if (s == "infinite") {
+            infinite = true;
+            continue;
+        }
+        // anything else we don't know, like "nodes", "mate" or the
+        // moves of "searchmoves", is skipped
+        if (s != "depth" && s != "movetime" && s != "wtime" && s != "btime"
+                && s != "winc" && s != "binc" && s != "movestogo")
+            continue;
+        if (!(in >> n)) {
+            in.clear();
+            continue;
+        }
+        if (s == "depth" && n > 0) {
+            depth[LIGHT] = depth[DARK] = min(n, MAX_PLY - 1);
+            to_depth = true;
+        } else if (s == "movetime")
+            move_time_ms = max(n, 1);
+        else if (s == "wtime")
+            clock_ms[LIGHT] = max(n, 0);
+        else if (s == "btime")
+            clock_ms[DARK] = max(n, 0);
+        else if (s == "winc")
+            inc_ms[LIGHT] = max(n, 0);
+        else if (s == "binc")
+            inc_ms[DARK] = max(n, 0);
+        else if (s == "movestogo")
+            moves_to_go = max(n, 0);
+    }
+    // a search without a limit we support still has to end
+    if (!infinite && !to_depth && move_time_ms == 0 && clock_ms[board.side] < 0) {
+        depth[LIGHT] = default_depth[LIGHT];
+        depth[DARK] = default_depth[DARK];
+    }
+    std::lock_guard<std::mutex> l(search_mut);
+    search_board = board;
+    stop_requested = false;
+    set_search_stop(false);
+    searching = true;
+    search_wake.notify_all();
+}
+
+static void setoption(std::istringstream& in)
+{
+    std::string s, name, value;
+    in >> s;  // "name"
+    while (in >> s && s != "value")
+        name += (name.empty() ? "" : " ") + s;
+    in >> value;
+    int n = atoi(value.c_str());
+    if (name == "Hash" && n > 0) {
+        resize_transposition_table(n, chx_huge_pages());
+    } else if (name == "Threads" && n > 0) {
+        // the search thread is one of them
+        task_counter.set_max(n - 1);
+#ifndef HPX_SUPPORT
+        workers.start(n - 1);
+#endif
+    }
+}
+
+void uci()
+{
+    node_t board;
+    init_hash();
+    init_bitboards();
+    init_board(board);
+    // report every depth; the jump to the final depth would hide them
+    iter_depth = MAX_PLY;
+    iteration_done = report;
+    default_depth[LIGHT] = depth[LIGHT];
+    default_depth[DARK] = depth[DARK];
+    search_thread = std::thread(search_loop);
+
+    std::string line = "uci";
+    do {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+
+        if (command == "uci") {
+            std::lock_guard<std::mutex> l(out_mut);
+            std::cout << "id name CHX" << std::endl;
+            std::cout << "id author Steve Brandt and Philip LeBlanc" << std::endl;
+            std::cout << "option name Hash type spin default " << chx_hash_mb()
+                << " min 1 max 65536" << std::endl;
+            std::cout << "option name Threads type spin default " << task_counter.get() + 1
+                << " min 1 max 256" << std::endl;
+            std::cout << "uciok" << std::endl;
+        } else if (command == "isready") {
+            std::lock_guard<std::mutex> l(out_mut);
+            std::cout << "readyok" << std::endl;
+        } else if (command == "stop") {
+            stop_thinking();
+        } else if (command == "quit") {
+            break;
+        } else if (command == "ucinewgame") {
+            wait_for_search();
+            clear_transposition_table();
+        } else if (command == "position") {
+            wait_for_search();
+            position(board, in);
+        } else if (command == "go") {
+            wait_for_search();
+            go(board, in);
+        } else if (command == "setoption") {
+            wait_for_search();
+            setoption(in);
+        }
+    } while (std::getline(std::cin, line));
+
+    stop_thinking();
+    {
+        std::lock_guard<std::mutex> l(search_mut);
+        quitting = true;
+    }
+    search_wake.notify_all();
+    search_thread.join();
+    iteration_done = 0;
+}
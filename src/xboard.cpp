@@ -4,6 +4,17 @@ http://home.hccnet.nl/h.g.muller/engine-intf.html */
 
 #include "search.hpp"
 #include <signal.h>
+#include <stdlib.h>
+
+/* the time part of a "level" command, in minutes or minutes:seconds */
+static int parse_base_ms(const std::string& s)
+{
+    int ms = 60000*atoi(s.c_str());
+    size_t colon = s.find(':');
+    if (colon != std::string::npos)
+        ms += 1000*atoi(s.c_str() + colon + 1);
+    return ms;
+}
 
 void xboard()
 {
@@ -11,7 +22,10 @@ void xboard()
     std::string command;
     int m;
     //int post = 0;
-    std::vector<chess_move> workq;
+    move_list workq;
+    // the clocks as xboard tells us, in milliseconds
+    int my_time = -1, opp_time = -1;
+    int mps = 0, inc = 0, st = 0;
 
     signal(SIGINT, SIG_IGN);
     
@@ -21,6 +35,7 @@ void xboard()
 
     node_t board;
     init_hash();
+    init_bitboards();
     init_board(board);
     computer_side = EMPTY;
 
@@ -29,20 +44,25 @@ void xboard()
     for (;;) {
         command.clear();
         if (board.side == computer_side) {
+            clock_ms[board.side] = my_time;
+            clock_ms[board.side ^ 1] = opp_time;
+            inc_ms[LIGHT] = inc_ms[DARK] = inc;
+            moves_to_go = (mps > 0) ? mps - (board.hply / 2) % mps : 0;
+            move_time_ms = st;
             think(board, false);
-            if (move_to_make.u == 0) {
+            if (move_to_make.get32BitMove() == 0) {
                 computer_side = EMPTY;
                 continue;
             }
-            std::cout << "chess_move " << move_str(move_to_make.b) << std::endl;
+            std::cout << "move " << move_str(move_to_make) << std::endl;
             std::cout.flush();
-            makemove(board, move_to_make.b);
+            makemove(board, move_to_make);
             board.ply = 0;
             workq.clear();
             gen(workq, board);
             print_result(workq, board);
 
-            move_to_make.u = 0;
+            move_to_make.set32BitMove(0);
             continue;
         }
         std::cin >> command;
@@ -54,7 +74,8 @@ void xboard()
             continue;
 
         if (command == "new") {
-            computer_side = EMPTY;
+            computer_side = DARK;
+            my_time = opp_time = -1;
             init_board(board);
             workq.clear();
             gen(workq, board);
@@ -80,7 +101,32 @@ void xboard()
             computer_side = LIGHT;
             continue;
         }
-        if (command == "otim") {
+        if (command == "time" || command == "otim") {
+            int cs;
+            std::cin >> cs;
+            (command == "time" ? my_time : opp_time) = 10*cs;
+            continue;
+        }
+        if (command == "level") {
+            std::string base;
+            double inc_s;
+            std::cin >> mps >> base >> inc_s;
+            my_time = opp_time = parse_base_ms(base);
+            inc = int(1000*inc_s);
+            st = 0;
+            continue;
+        }
+        if (command == "st") {
+            int s;
+            std::cin >> s;
+            st = 1000*s;
+            continue;
+        }
+        if (command == "sd") {
+            int d;
+            std::cin >> d;
+            if (d > 0)
+                depth[LIGHT] = depth[DARK] = d;
             continue;
         }
         if (command == "go") {
@@ -89,20 +135,20 @@ void xboard()
         }
         if (command == "hint") {
             think(board, false);
-            if (move_to_make.u == 0)
+            if (move_to_make.get32BitMove() == 0)
                 continue;
-            std::cout << "Hint: " << move_str(move_to_make.b) << std::endl;
+            std::cout << "Hint: " << move_str(move_to_make) << std::endl;
             continue;
         }
 
         m = parse_move(workq, command.c_str());
         chess_move mov;
-        mov.u = m;
+        mov = m;
         node_t newboard = board;
-        if (m == -1 || !makemove(newboard, mov.b))
-            std::cerr << "Error (unknown command): " << command << std::endl;
+        if (m == -1 || !makemove(newboard, mov))
+            std::cout << "Error (unknown command): " << command << std::endl;
         else {
-            makemove(board, mov.b);
+            makemove(board, mov);
             board.ply = 0;
             workq.clear();
             gen(workq, board);
@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////
+//  Copyright (c) 2011 Steve Brandt and Philip LeBlanc
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file BOOST_LICENSE_1_0.rst or copy at http://www.boost.org/LICENSE_1_0.txt)
+////////////////////////////////////////////////////////////////////////////////
+/*
+ *  zkey.cpp
+ */
+
+#include "zkey.hpp"
+#include "data.hpp"
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include <sys/mman.h>
+
+#define TRANSPOSE_ON 1
+
+zbucket_t *transposition_table = 0;
+size_t table_size = 0;
+static size_t bucket_mask = 0;
+
+/* The generation is bumped at the start of every search instead of
+   clearing the table. Entries from earlier searches stay usable, but
+   they are the first to be replaced. */
+static uint8_t generation = 0;
+
+/* The low 32 bits of the key hold the best chess_move, the depth
+   (plus one, so that an empty slot never matches) and the
+   generation the entry was written in. */
+#define META_MASK     0xFFFFFFFFULL
+#define META_MOVE(m)  (uint16_t((m) & 0xFFFF))
+#define META_DEPTH(m) (int((m) >> 16) & 0xFF)
+#define META_GEN(m)   (uint8_t((m) >> 24))
+
+/* How much a generation of age counts against an entry's depth
+   when picking a slot to replace. With 8 an entry from an earlier
+   search only survives over a much shallower current one. */
+#define AGE_WEIGHT    8
+
+/* The low bits of the hash pick the bucket, so the high 32 bits are
+   the ones that tell positions in the same bucket apart. */
+static inline uint64_t tt_lock(const node_t& board)
+{
+    return board.hash & ~META_MASK;
+}
+
+static inline zbucket_t *tt_bucket(const node_t& board)
+{
+    return &transposition_table[size_t(board.hash) & bucket_mask];
+}
+
+/* Reads a slot. Returns the key with the meta data in the low bits;
+   a slot that is empty or was torn by a concurrent write simply
+   won't match any lock. */
+static inline uint64_t tt_read(const zkey_t& z,uint64_t& scores)
+{
+    scores = z.scores.load(boost::memory_order_relaxed);
+    return z.check.load(boost::memory_order_relaxed) ^ scores;
+}
+
+/* resize_transposition_table() allocates a table of at most mb megabytes,
+   rounded down to a power of two number of buckets so the index is a mask.
+   With huge_pages set the table is aligned to 2MB and marked for
+   transparent huge pages, which cuts TLB misses when probing a large
+   table. Must not be called while a search is running. */
+
+bool resize_transposition_table(size_t mb,bool huge_pages)
+{
+    const size_t huge_page = 2*1024*1024;
+    size_t n = 1;
+    while (2*n*sizeof(zbucket_t) <= mb*1024*1024)
+        n *= 2;
+
+    size_t bytes = n*sizeof(zbucket_t);
+    size_t align = (huge_pages && bytes >= huge_page) ? huge_page : sizeof(zbucket_t);
+    void *mem = 0;
+    if (posix_memalign(&mem, align, bytes) != 0) {
+        std::cerr << "Unable to allocate a " << mb << " MB hash table" << std::endl;
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (align == huge_page)
+        madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+    free(transposition_table);
+    transposition_table = static_cast<zbucket_t *>(mem);
+    for (size_t i = 0; i < n; i++)
+        new (&transposition_table[i]) zbucket_t;
+    table_size = n*bucket_slots;
+    bucket_mask = n-1;
+    return true;
+}
+
+void clear_transposition_table()
+{
+    for (size_t i = 0; i <= bucket_mask; i++) {
+        for (int j = 0; j < bucket_slots; j++) {
+            transposition_table[i].slot[j].check.store(0, boost::memory_order_relaxed);
+            transposition_table[i].slot[j].scores.store(0, boost::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void age_transposition_table()
+{
+    generation++;
+}
+
+bool get_transposition_value(const node_t& board,score_t& lower,score_t& upper) {
+    lower = bad_min_score;
+    upper = bad_max_score;
+#ifdef TRANSPOSE_ON
+    zbucket_t *b = tt_bucket(board);
+    const uint64_t lock = tt_lock(board);
+    for (int i = 0; i < bucket_slots; i++) {
+        uint64_t scores;
+        uint64_t key = tt_read(b->slot[i], scores);
+        if ((key & ~META_MASK) == lock && META_DEPTH(key) == board.depth+1) {
+            lower = int32_t(scores >> 32);
+            upper = int32_t(scores & META_MASK);
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+void set_transposition_value(const node_t& board,score_t lower,score_t upper,chess_move best) {
+#ifdef TRANSPOSE_ON
+    zbucket_t *b = tt_bucket(board);
+    const uint64_t lock = tt_lock(board);
+    // Pick the slot holding this position at this depth if there is
+    // one, otherwise the one whose depth is worth the least after
+    // taking its age into account. Empty slots are worth nothing.
+    int victim = 0;
+    int victim_worth = 1 << 30;
+    for (int i = 0; i < bucket_slots; i++) {
+        uint64_t scores;
+        uint64_t key = tt_read(b->slot[i], scores);
+        if ((key & ~META_MASK) == lock && META_DEPTH(key) == board.depth+1) {
+            victim = i;
+            break;
+        }
+        int worth = META_DEPTH(key);
+        if (worth != 0)
+            worth -= AGE_WEIGHT*uint8_t(generation - META_GEN(key));
+        if (worth < victim_worth) {
+            victim = i;
+            victim_worth = worth;
+        }
+    }
+    // The scores fit in 32 bits: the base is within +/-11000
+    // and is shifted up by BITS (see score.hpp).
+    uint64_t scores = (uint64_t(uint32_t(int32_t(lower))) << 32)
+                    | uint64_t(uint32_t(int32_t(upper)));
+    uint64_t key = lock
+                 | (uint64_t(generation) << 24)
+                 | (uint64_t(board.depth+1) << 16)
+                 | best.get16BitMove();
+    b->slot[victim].check.store(key ^ scores, boost::memory_order_relaxed);
+    b->slot[victim].scores.store(scores, boost::memory_order_relaxed);
+#endif
+}
+
+/* get_transposition_move() returns the best chess_move stored for this
+   position at any depth (the deepest one wins), or 0 if there is none.
+   It is used to order the moves before the search. */
+
+uint16_t get_transposition_move(const node_t& board) {
+    uint16_t mv = 0;
+#ifdef TRANSPOSE_ON
+    zbucket_t *b = tt_bucket(board);
+    const uint64_t lock = tt_lock(board);
+    int best_depth = 0;
+    for (int i = 0; i < bucket_slots; i++) {
+        uint64_t scores;
+        uint64_t key = tt_read(b->slot[i], scores);
+        if ((key & ~META_MASK) == lock && META_MOVE(key) != 0
+                && META_DEPTH(key) > best_depth) {
+            mv = META_MOVE(key);
+            best_depth = META_DEPTH(key);
+        }
+    }
+#endif
+    return mv;
+}
@@ -0,0 +1,31 @@
+require "test/unit"
+require "fileutils"
+include FileUtils
+
+
+class TestPerft < Test::Unit::TestCase
+
+
+	def setup
+@chx_exe = "../../build_chx/src/chx"
+@input =
+"""
+perftsuite ../inputs/perft.epd 3
+quit
+
+"""
+		if Dir[@chx_exe].empty?
+			puts "Please specify the path to the chx executable in $chx_exe"
+			exit
+		end
+		f = open(".test","w+")
+    f.write @input
+    f.close
+	end
+
+	def test_perft
+		val = `#{@chx_exe} < .test`
+		assert( val =~ /All counts correct/ )
+		assert( val !~ /FAILED/ )
+	end
+end
@@ -1,3 +1,4 @@
 require "test/unit"
 require "./tc_enpassant.rb"
 require "./tc_castling.rb"
+require "./tc_perft.rb"